@@ -0,0 +1,150 @@
+#include "bitmap.h"
+#include "clip.h"
+#include "util.h"
+#include <string.h>
+
+/* Number of 64 bit words of a bitset container */
+#define BITMAP_WORDS  (65536 / 64)
+
+void bitmap_init(dbitmap_t *bitmap)
+{
+  assert(bitmap);
+
+  bitmap->containers = NULL;
+  bitmap->count = 0;
+  bitmap->allocated = 0;
+  bitmap->cardinality = 0;
+  bitmap->size = 0;
+}
+
+void bitmap_destroy(dbitmap_t *bitmap)
+{
+  if(!bitmap) return;
+
+  guint32 i;
+  for(i = 0; i < bitmap->count; i += 1) {
+    free(bitmap->containers[i].array);
+    free(bitmap->containers[i].bits);
+  } /* for ... */
+
+  free(bitmap->containers);
+  bitmap_init(bitmap);
+}
+
+void bitmap_append(dbitmap_t *bitmap, guint32 value)
+{
+  assert(bitmap);
+
+  const guint16 key = value >> 16;
+  const guint16 low = value & 0xffff;
+  dbcontainer_t *last = bitmap->count ? bitmap->containers + bitmap->count - 1 : NULL;
+
+  /* Start a new container for the upper bits */
+  if(!last || (key != last->key)) {
+    assert2(!last || (key > last->key), "Values must be appended in increasing order!");
+
+    if(bitmap->allocated == bitmap->count) {
+      bitmap->size -= bitmap->allocated * sizeof(dbcontainer_t);
+      bitmap->allocated = bitmap->allocated ? 2 * bitmap->allocated : 4;
+      bitmap->containers = (dbcontainer_t*)xrealloc(bitmap->containers, bitmap->allocated * sizeof(dbcontainer_t));
+      bitmap->size += bitmap->allocated * sizeof(dbcontainer_t);
+    } /* if ... */
+
+    last = bitmap->containers + bitmap->count;
+    last->key = key;
+    last->cardinality = 0;
+    last->array = NULL;
+    last->bits = NULL;
+    bitmap->count += 1;
+  } /* if ... */
+
+  if(last->bits) {
+    last->bits[low >> 6] |= (guint64)1 << (low & 63);
+
+  } else if(BITMAP_ARRAY_MAX == last->cardinality) {
+    /* Array has reached the size of a bitset, so convert it */
+    guint32 i;
+    last->bits = (guint64*)xmalloc(BITMAP_WORDS * sizeof(guint64));
+    memset(last->bits, 0, BITMAP_WORDS * sizeof(guint64));
+
+    for(i = 0; i < last->cardinality; i += 1) {
+      last->bits[last->array[i] >> 6] |= (guint64)1 << (last->array[i] & 63);
+    } /* for ... */
+
+    last->bits[low >> 6] |= (guint64)1 << (low & 63);
+    bitmap->size += BITMAP_WORDS * sizeof(guint64);
+    bitmap->size -= BITMAP_ARRAY_MAX * sizeof(guint16);
+    free(last->array);
+    last->array = NULL;
+
+  } else {
+    /* Arrays grow geometrically up to BITMAP_ARRAY_MAX */
+    const guint32 n = last->cardinality;
+    if(!n || ((4 <= n) && !(n & (n - 1)))) {
+      const guint32 capacity = n ? min(2 * n, BITMAP_ARRAY_MAX) : 4;
+      last->array = (guint16*)xrealloc(last->array, capacity * sizeof(guint16));
+      bitmap->size += (capacity - n) * sizeof(guint16);
+    } /* if ... */
+
+    assert2(!n || (low > last->array[n - 1]), "Values must be appended in increasing order!");
+    last->array[n] = low;
+
+  } /* if ... */
+
+  last->cardinality += 1;
+  bitmap->cardinality += 1;
+}
+
+void bitmap_iter_init(dbiter_t *iter, const dbitmap_t *bitmap)
+{
+  assert(iter);
+  assert(bitmap);
+
+  iter->bitmap = bitmap;
+  iter->container = 0;
+  iter->position = 0;
+  iter->word = (bitmap->count && bitmap->containers->bits) ? *bitmap->containers->bits : 0;
+}
+
+int bitmap_iter_next(dbiter_t *iter, guint32 *value)
+{
+  assert(iter);
+  assert(value);
+
+  while(iter->container < iter->bitmap->count) {
+    const dbcontainer_t *c = iter->bitmap->containers + iter->container;
+    const guint32 high = (guint32)c->key << 16;
+
+    if(c->array && (iter->position < c->cardinality)) {
+      *value = high | c->array[iter->position];
+      iter->position += 1;
+      return 1;
+    } /* if ... */
+
+    if(c->bits) {
+      /* Skip empty words, then take the lowest bit set */
+      while(!iter->word && (iter->position + 1 < BITMAP_WORDS)) {
+        iter->position += 1;
+        iter->word = c->bits[iter->position];
+      } /* while ... */
+
+      if(iter->word) {
+        *value = high | (iter->position << 6) | __builtin_ctzll(iter->word);
+        iter->word &= iter->word - 1;
+        return 1;
+      } /* if ... */
+    } /* if ... */
+
+    /* Continue with next container */
+    iter->container += 1;
+    iter->position = 0;
+    iter->word = 0;
+
+    if(iter->container < iter->bitmap->count) {
+      c = iter->bitmap->containers + iter->container;
+      if(c->bits) iter->word = *c->bits;
+    } /* if ... */
+  } /* while ... */
+
+  return 0;
+}
@@ -0,0 +1,70 @@
+#ifndef DMENU_BITMAP_H
+#define DMENU_BITMAP_H
+#include <glib.h>
+
+typedef struct dmenu_bitmap dbitmap_t;
+typedef struct dmenu_bitmap_container dbcontainer_t;
+typedef struct dmenu_bitmap_iter dbiter_t;
+
+/** \brief Maximum number of values stored as sorted array in a container
+ *
+ * Containers with more values are stored as bitset of 8 KiB, which is the size
+ * of an array of this many values.
+ */
+#define BITMAP_ARRAY_MAX  4096
+
+/** \brief Values sharing their upper 16 bits
+ *
+ * Depending on its cardinality, a container either stores the lower 16 bits
+ * of its values as sorted array or as bitset.
+ */
+struct dmenu_bitmap_container
+{
+  /** \brief Upper 16 bits of all values */
+  guint16 key;
+  /** \brief Number of values */
+  guint32 cardinality;
+  /** \brief Sorted values, if \c cardinality doesn't exceed \c BITMAP_ARRAY_MAX */
+  guint16 *array;
+  /** \brief Bitset of 65536 bits, otherwise */
+  guint64 *bits;
+};
+
+/** \brief Compressed bitmap
+ *
+ * The bitmap stores a set of 32 bit values in containers, similar to roaring
+ * bitmaps. Values must be appended in increasing order.
+ */
+struct dmenu_bitmap
+{
+  dbcontainer_t *containers;
+  guint32 count;
+  guint32 allocated;
+  /** \brief Number of values */
+  size_t cardinality;
+  /** \brief Number of bytes allocated */
+  size_t size;
+};
+
+/** \brief Iterator over the values of a bitmap in increasing order */
+struct dmenu_bitmap_iter
+{
+  const dbitmap_t *bitmap;
+  guint32 container;
+  guint32 position;
+  guint64 word;
+};
+
+void bitmap_init(dbitmap_t *bitmap);
+void bitmap_destroy(dbitmap_t *bitmap);
+/** \brief Add \c value, which must be larger than all values added before */
+void bitmap_append(dbitmap_t *bitmap, guint32 value);
+
+void bitmap_iter_init(dbiter_t *iter, const dbitmap_t *bitmap);
+/** \brief Get next value
+ *
+ * On success the function returns non-zero and stores the next value in \c
+ * value. Otherwise all values have been visited.
+ */
+int  bitmap_iter_next(dbiter_t *iter, guint32 *value);
+#endif /* DMENU_BITMAP_H */
@@ -10,20 +10,33 @@ PREFIX = ${DESTDIR}/usr
 MANPREFIX = ${PREFIX}/share/man
 
 # Select packages
-PACKAGES = glib-2.0 fontconfig libconfig x11 xft
+PACKAGES = glib-2.0 gio-2.0 fontconfig libconfig x11 xft
 
 # Xinerama, comment if you don't want it
 PACKAGES += xinerama
 CFLAGS += -DXINERAMA
 
+# MIT-SHM rendering backend (--shm), comment if you don't want it
+PACKAGES += xext freetype2
+CFLAGS += -DMITSHM
+
+# Reading zstd compressed items, uncomment if you want it
+# PACKAGES += libzstd
+# CFLAGS += -DZSTD
+
 # Flags
 # CPPFLAGS = -D_DEFAULT_SOURCE -D_BSD_SOURCE -D_XOPEN_SOURCE=700 -D_POSIX_C_SOURCE=200809L -DVERSION=\"${VERSION}\" ${XINERAMAFLAGS}
 CPPFLAGS = -DVERSION=\"${VERSION}\"
 # CFLAGS   = -std=c99 -pedantic -Wall -Os ${INCS} ${CPPFLAGS}
 CFLAGS += -Wall ${CPPFLAGS}
 
-RELEASE_CFLAGS = -g0 -O2 -DNDEBUG
+RELEASE_CFLAGS = -g0 -O2 -DNDEBUG ${PGO_CFLAGS}
 DEBUG_CFLAGS = -g3 -O0
 
+# Profile-guided optimization (make dmenu-pgo)
+PGO_GENERATE_CFLAGS = -fprofile-generate -flto
+PGO_USE_CFLAGS = -fprofile-use -fprofile-correction -Wno-missing-profile -flto
+PGO_TRAIN_ITEMS = 5000
+
 # Compiler and linker
 CC = cc
@@ -1,5 +1,10 @@
 #include "controller.h"
+#include "stats.h"
 #include <ctype.h>
+#include <time.h>
+
+/* Number of items scanned for matches at a time, while idle */
+#define CONTROL_IDLE_ITEMS 16384
 
 void init_control(dctrl_t *control, const dx11_t *x, const Window hwnd)
 {/*{{{*/
@@ -13,6 +18,14 @@ void init_control(dctrl_t *control, const dx11_t *x, const Window hwnd)
   inputbuffer_init(&control->input);
 	control->xim = XOpenIM(control->x->display, NULL, NULL, NULL);
 	control->xic = XCreateIC(control->xim, XNInputStyle, XIMPreeditNothing | XIMStatusNothing, XNClientWindow, hwnd, XNFocusWindow, hwnd, NULL);
+	control->do_exit = 0;
+	control->result = NULL;
+}/*}}}*/
+
+int control_grab_keyboard(dctrl_t *control)
+{/*{{{*/
+  assert(control);
+  debug("Grab keyboard.");
 
 	struct timespec ts = { .tv_sec = 0, .tv_nsec = 1000000  };
 	int i;
@@ -20,12 +33,31 @@ void init_control(dctrl_t *control, const dx11_t *x, const Window hwnd)
 	/* try to grab keyboard, we may have to wait for another process to ungrab */
 	for (i = 0; i < 1000; i++) {
 		const int ok = XGrabKeyboard(control->x->display, control->x->root, True, GrabModeAsync, GrabModeAsync, CurrentTime);
-		if(GrabSuccess == ok) return;
+		if(GrabSuccess == ok) return 0;
 
 		nanosleep(&ts, NULL);
 	} /* for ... */
 
-	die("Cannot grab keyboard");
+	warning("Cannot grab keyboard");
+	return -1;
+}/*}}}*/
+
+void control_ungrab_keyboard(dctrl_t *control)
+{/*{{{*/
+  assert(control);
+  debug("Ungrab keyboard.");
+
+	XUngrabKeyboard(control->x->display, CurrentTime);
+}/*}}}*/
+
+void control_reset(dctrl_t *control)
+{/*{{{*/
+  assert(control);
+  debug("Reset control.");
+
+  inputbuffer_set(&control->input, "");
+	control->do_exit = 0;
+	control->result = NULL;
 }/*}}}*/
 
 void control_on_keypress(dctrl_t *control, xcmd_t *model, XKeyEvent *ev)
@@ -151,7 +183,11 @@ void control_on_keypress(dctrl_t *control, xcmd_t *model, XKeyEvent *ev)
 	  case XK_Down: xcmd_update_selected(model, +1, 1); break;
 
 	  case XK_Prior:  /* Page Up */
+	    if(model->matches.page) xcmd_update_selected(model, (long)model->matches.selected - (long)model->matches.page, 0);
+	    break;
+
 	  case XK_Next:   /* Page Down */
+	    if(model->matches.page) xcmd_update_selected(model, model->matches.selected + model->matches.page, 0);
 	    break;
 
 	  case XK_Return:   /* fallthrough */
@@ -160,7 +196,7 @@ void control_on_keypress(dctrl_t *control, xcmd_t *model, XKeyEvent *ev)
 
 	    if(model->matches.selected < model->matches.count) {
 	      debug("Select item %lu.", model->matches.selected);
-	      control->result = model->matches.index[model->matches.selected];
+	      control->result = xcmd_item_output(model, model->matches.index[model->matches.selected]);
 
 	    } else {
 	      debug("Select input.");
@@ -205,7 +241,11 @@ void run_control(dctrl_t *control, xcmd_t *model)
   debug("Enter main event loop.");
 
 	control->do_exit = 0;
-	while (!control->do_exit && !XNextEvent(control->x->display, &ev)) {
+	while (!control->do_exit) {
+	  /* Scan the remaining items for matches, while no events are pending */
+	  if(!XPending(control->x->display) && xcmd_continue_matching(model, G_MAXSIZE, CONTROL_IDLE_ITEMS)) continue;
+	  if(XNextEvent(control->x->display, &ev)) break;
+
 		if (XFilterEvent(&ev, control->hwnd))
 			continue;
 		switch(ev.type) {
@@ -219,7 +259,9 @@ void run_control(dctrl_t *control, xcmd_t *model)
 	  		break;
 
 		  case KeyPress:
+		    stats_keypress_begin();
 		    control_on_keypress(control, model, &ev.xkey);
+		    stats_keypress_end(ev.xkey.time);
 			  break;
 
 		  // case SelectionNotify:
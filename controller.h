@@ -13,12 +13,17 @@ struct dmenu_control
   XIM xim;
   XIC xic;
   inpbuf_t input;
-  int fast_startup;  /* Perform fast start-up */
+  int fast_startup;  /* Ignored, start-up always reads input concurrently */
   int do_exit;  /* Exit main loop */
   const char *result;
   const char *exec;
 };/*}}}*/
 
 void init_control(dctrl_t *control, const dx11_t *x, const Window hwnd);
+/* Grab keyboard, retrying for about a second. On success zero is returned. */
+int  control_grab_keyboard(dctrl_t *control);
+void control_ungrab_keyboard(dctrl_t *control);
+/* Clear input and result for showing the menu again */
+void control_reset(dctrl_t *control);
 void run_control(dctrl_t *control, xcmd_t *model);
 #endif /* DMENU_CONTROLLER_H */
@@ -0,0 +1,348 @@
+#include "daemon.h"
+#include "util.h"
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* Set by SIGTERM or SIGINT to leave the daemon loop */
+static volatile sig_atomic_t daemon_stop = 0;
+
+static void daemon_on_signal(int signum)
+{/*{{{*/
+  daemon_stop = 1;
+}/*}}}*/
+
+static void daemon_set_free(gpointer data)
+{/*{{{*/
+  xcmd_t *model = (xcmd_t*)data;
+
+  xcmd_destroy(model);
+  free(model);
+}/*}}}*/
+
+static int daemon_address(struct sockaddr_un *addr, const char *path)
+{/*{{{*/
+  assert(addr);
+  assert(path);
+
+  memset(addr, 0, sizeof(struct sockaddr_un));
+  addr->sun_family = AF_UNIX;
+
+  warn_if(sizeof(addr->sun_path) <= strlen(path), "Socket path is too long: `%s'", path);
+  if(sizeof(addr->sun_path) <= strlen(path)) return -1;
+
+  strcpy(addr->sun_path, path);
+  return 0;
+}/*}}}*/
+
+char *daemon_default_path(void)
+{/*{{{*/
+  return g_build_filename(g_get_user_runtime_dir(), "dmenu.socket", NULL);
+}/*}}}*/
+
+int daemon_init(ddaemon_t *d, const char *path, const xcfg_t *config, dview_t *view, dctrl_t *control)
+{/*{{{*/
+  assert(d);
+  assert(path);
+  assert(view);
+  assert(control);
+  debug("Initialize daemon at `%s'.", path);
+
+  struct sockaddr_un addr;
+  if(daemon_address(&addr, path)) return -1;
+
+  d->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  warn_if(0 > d->fd, "Cannot create socket: %m");
+  if(0 > d->fd) return -1;
+
+  /* Remove stale socket and make the new one private */
+  unlink(path);
+  const mode_t old_mask = umask(0077);
+  const int bind_failed = bind(d->fd, (struct sockaddr*)&addr, sizeof(addr));
+  umask(old_mask);
+
+  const int listen_failed = bind_failed || listen(d->fd, 8);
+  warn_if(listen_failed, "Cannot listen on socket `%s': %m", path);
+
+  if(listen_failed) {
+    close(d->fd);
+    d->fd = -1;
+    return -1;
+  } /* if ... */
+
+  d->config = config;
+  d->view = view;
+  d->control = control;
+  d->path = g_strdup(path);
+  d->sets = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, daemon_set_free);
+
+  return 0;
+}/*}}}*/
+
+void daemon_destroy(ddaemon_t *d)
+{/*{{{*/
+  if(!d) return;
+
+  if(0 <= d->fd) {
+    close(d->fd);
+    unlink(d->path);
+    d->fd = -1;
+  } /* if ... */
+
+  g_free(d->path);
+  d->path = NULL;
+
+  if(d->sets) g_hash_table_destroy(d->sets);
+  d->sets = NULL;
+}/*}}}*/
+
+/* Read items of set name from in */
+static int daemon_load(ddaemon_t *d, const char *name, FILE *in, FILE *out)
+{/*{{{*/
+  assert(d);
+  assert(name);
+  debug("Load item set `%s'.", name);
+
+  xcmd_t *model = (xcmd_t*)xmalloc(sizeof(xcmd_t));
+  xcmd_init(model, d->config);
+
+  /* The client may close the connection while sending items */
+  if(xcmd_read_items(model, in)) {
+    daemon_set_free(model);
+    fprintf(out, "error Cannot read items\n");
+    return -1;
+  } /* if ... */
+
+  if(!model->items.count) {
+    daemon_set_free(model);
+    fprintf(out, "error No items\n");
+    return -1;
+  } /* if ... */
+
+  xcmd_finish_items(model);
+  g_hash_table_replace(d->sets, g_strdup(name), model);
+  fprintf(out, "ok %lu\n", model->items.count);
+
+  return 0;
+}/*}}}*/
+
+/* Show set name until the user selects an item or cancels */
+static int daemon_show(ddaemon_t *d, const char *name, char *prompt, FILE *out)
+{/*{{{*/
+  assert(d);
+  assert(name);
+  debug("Show item set `%s'.", name);
+
+  xcmd_t *model = (xcmd_t*)g_hash_table_lookup(d->sets, name);
+
+  if(!model) {
+    fprintf(out, "error No such set: %s\n", name);
+    return -1;
+  } /* if ... */
+
+  char *default_prompt = d->view->prompt.text;
+  viewer_set_prompt(d->view, prompt);
+  control_reset(d->control);
+
+  /* Render first frame before mapping the window */
+	model->observer = (void(*)(void*,const xcmd_t*))viewer_update;
+	model->observer_data = d->view;
+  xcmd_update_matching(model, NULL);
+  model->has_changed = 1;
+  xcmd_notify_observer(model);
+
+  viewer_show(d->view);
+
+  if(control_grab_keyboard(d->control)) {
+    fprintf(out, "error Cannot grab keyboard\n");
+  } else {
+    run_control(d->control, model);
+    control_ungrab_keyboard(d->control);
+
+    if(d->control->result) {
+      fprintf(out, "ok %s\n", d->control->result);
+    } else {
+      fprintf(out, "cancel\n");
+    } /* if ... */
+  } /* if ... */
+
+  viewer_hide(d->view);
+  viewer_set_prompt(d->view, default_prompt);
+  model->observer = NULL;
+  model->observer_data = NULL;
+
+  return 0;
+}/*}}}*/
+
+static void daemon_serve(ddaemon_t *d, FILE *in, FILE *out)
+{/*{{{*/
+  char *line = NULL;
+  size_t line_size = 0;
+  const ssize_t n = getline(&line, &line_size, in);
+
+  if(0 < n) {
+    if('\n' == line[n - 1]) line[n - 1] = '\0';
+    debug("Receive request `%s'.", line);
+
+    if(!strncmp(line, "load ", 5)) {
+      daemon_load(d, line + 5, in, out);
+
+    } else if(!strncmp(line, "show ", 5)) {
+      char *name = line + 5;
+      char *prompt = strchr(name, '\t');
+      if(prompt) *(prompt++) = '\0';
+
+      daemon_show(d, name, (prompt && *prompt) ? prompt : NULL, out);
+
+    } else {
+      fprintf(out, "error Invalid request\n");
+
+    } /* if ... */
+  } /* if ... */
+
+  free(line);
+}/*}}}*/
+
+int daemon_run(ddaemon_t *d)
+{/*{{{*/
+  assert(d);
+  debug("Enter daemon loop.");
+
+  /* Interrupt accept() on termination, so the caller can clean up */
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = daemon_on_signal;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGTERM, &sa, NULL);
+  sigaction(SIGINT, &sa, NULL);
+
+  daemon_stop = 0;
+  while(!daemon_stop) {
+    const int fd = accept(d->fd, NULL, NULL);
+    if((0 > fd) && (EINTR == errno)) continue;
+
+    /* Failures of single connections, e.g. ECONNABORTED or EMFILE, don't
+     * stop the daemon */
+    warn_if(0 > fd, "Cannot accept connection: %m");
+    if(0 > fd) continue;
+
+    /* Separate streams for reading and writing a socket */
+    FILE *in = fdopen(fd, "r");
+    const int fd_out = in ? dup(fd) : -1;
+    FILE *out = (0 <= fd_out) ? fdopen(fd_out, "w") : NULL;
+
+    if(!out) {
+      warning("Cannot open connection: %m");
+      if(0 <= fd_out) close(fd_out);
+      if(in) fclose(in);
+      else close(fd);
+      continue;
+    } /* if ... */
+
+    daemon_serve(d, in, out);
+
+    fclose(out);
+    fclose(in);
+  } /* while ... */
+
+  debug("Leave daemon loop.");
+  return 0;
+}/*}}}*/
+
+/* Send request followed by payload, if any, and receive reply */
+static char *daemon_request(const char *path, const char *request, FILE *payload)
+{/*{{{*/
+  assert(path);
+  assert(request);
+
+  struct sockaddr_un addr;
+  if(daemon_address(&addr, path)) return NULL;
+
+  const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  warn_if(0 > fd, "Cannot create socket: %m");
+  if(0 > fd) return NULL;
+
+  if(connect(fd, (struct sockaddr*)&addr, sizeof(addr))) {
+    warning("Cannot connect to daemon at `%s': %m", path);
+    close(fd);
+    return NULL;
+  } /* if ... */
+
+  FILE *out = fdopen(dup(fd), "w");
+  FILE *in = fdopen(fd, "r");
+  assert2(in && out, "Cannot open connection: %m");
+
+  fprintf(out, "%s\n", request);
+
+  if(payload) {
+    char buffer[BUFSIZ];
+    size_t n;
+
+    while(0 < (n = fread(buffer, 1, sizeof(buffer), payload))) {
+      fwrite(buffer, 1, n, out);
+    } /* while ... */
+  } /* if ... */
+
+  /* Signal end of request */
+  fclose(out);
+  shutdown(fd, SHUT_WR);
+
+  char *line = NULL;
+  size_t line_size = 0;
+  const ssize_t n = getline(&line, &line_size, in);
+  fclose(in);
+
+  warn_if(0 >= n, "Daemon didn't reply.");
+  if(0 >= n) {
+    free(line);
+    return NULL;
+  } /* if ... */
+
+  if('\n' == line[n - 1]) line[n - 1] = '\0';
+  warn_if(!strncmp(line, "error ", 6), "Daemon failed: %s", line + 6);
+
+  return line;
+}/*}}}*/
+
+int daemon_client_load(const char *path, const char *name, FILE *f)
+{/*{{{*/
+  assert(name);
+  debug("Send item set `%s' to daemon.", name);
+
+  char *request = g_strdup_printf("load %s", name);
+  char *reply = daemon_request(path, request, f);
+  const int ok = reply && !strncmp(reply, "ok ", 3);
+
+  g_free(request);
+  free(reply);
+
+  return ok ? 0 : -1;
+}/*}}}*/
+
+int daemon_client_show(const char *path, const char *name, const char *prompt, FILE *out)
+{/*{{{*/
+  assert(name);
+  debug("Request daemon to show item set `%s'.", name);
+
+  char *request = g_strdup_printf("show %s\t%s", name, prompt ? prompt : "");
+  char *reply = daemon_request(path, request, NULL);
+  int status = -1;
+
+  if(reply && !strncmp(reply, "ok ", 3)) {
+    fprintf(out, "%s\n", reply + 3);
+    status = 0;
+
+  } else if(reply && !strcmp(reply, "cancel")) {
+    status = 1;
+
+  } /* if ... */
+
+  g_free(request);
+  free(reply);
+
+  return status;
+}/*}}}*/
@@ -0,0 +1,72 @@
+#ifndef DMENU_DAEMON_H
+#define DMENU_DAEMON_H
+#include "controller.h"
+#include "viewer.h"
+#include "x.h"
+#include "xcmd.h"
+#include <glib.h>
+#include <stdio.h>
+
+typedef struct dmenu_daemon ddaemon_t;
+
+/** \brief Resident menu server
+ *
+ * The daemon keeps the connection to the X server, the viewer with its fonts
+ * and styles, and named item sets with their indexes. Clients connect to a
+ * UNIX socket and send a single request per connection:
+ * - <tt>load NAME</tt>, followed by the items until end of stream. The set
+ *   \c NAME is created or replaced. The reply is <tt>ok COUNT</tt>.
+ * - <tt>show NAME\\tPROMPT</tt> shows set \c NAME using \c PROMPT. The reply
+ *   is <tt>ok SELECTION</tt> or \c cancel.
+ *
+ * Failed requests are answered by <tt>error MESSAGE</tt>. Every request and
+ * reply is terminated by a newline character.
+ */
+struct dmenu_daemon
+{/*{{{*/
+  const xcfg_t *config; /* Configuration of new item sets */
+  dview_t *view;
+  dctrl_t *control;
+  GHashTable *sets; /* Item sets by name */
+  char *path; /* Path of socket */
+  int fd;     /* Listening socket */
+};/*}}}*/
+
+/** \brief Default socket path
+ *
+ * Returns a newly allocated path inside of the user's runtime directory.
+ */
+char *daemon_default_path(void);
+
+/** \brief Initialize daemon
+ *
+ * Binds the socket at \c path. The viewer must have been initialized, but not
+ * shown; the controller must have been initialized without grabbing the
+ * keyboard. On success zero is returned.
+ */
+int  daemon_init(ddaemon_t *d, const char *path, const xcfg_t *config, dview_t *view, dctrl_t *control);
+void daemon_destroy(ddaemon_t *d);
+
+/** \brief Serve requests
+ *
+ * Failures of single connections are reported and don't stop the daemon.
+ * Returns zero after SIGTERM or SIGINT, so the daemon can be destroyed.
+ */
+int daemon_run(ddaemon_t *d);
+
+/** \brief Send item set to the daemon
+ *
+ * Reads items from \c f and sends them as set \c name to the daemon listening
+ * at \c path. On success zero is returned.
+ */
+int daemon_client_load(const char *path, const char *name, FILE *f);
+
+/** \brief Show item set using the daemon
+ *
+ * Asks the daemon listening at \c path to show set \c name with \c prompt,
+ * which may be \c NULL. The selection is written to \c out. Returns zero, if
+ * an item was selected, a positive value if the menu was cancelled and a
+ * negative value on error.
+ */
+int daemon_client_show(const char *path, const char *name, const char *prompt, FILE *out);
+#endif /* DMENU_DAEMON_H */
@@ -1,8 +1,11 @@
 /* See LICENSE file for copyright and license details. */
+#include "source.h"
+#include "stats.h"
 #include "util.h"
 #include "xcmd.h"
 #include <glib.h>
 #include <getopt.h>
+#include <signal.h>
 // #include <libconfig.h>
 
 #include "config.h"
@@ -190,16 +193,88 @@ read_configuration(char const *const path)
 #include "x.h"
 #include "viewer.h"
 #include "controller.h"
+#include "daemon.h"
 
-void dmenu_getopt(dx11_t *x, xcmd_t *model, dview_t *view, dctrl_t *control, int argc, char *argv[])
+/* Width and height of the offscreen buffer used for benchmarks */
+#define BENCHMARK_WIDTH   1920
+#define BENCHMARK_HEIGHT  1080
+
+/* Number of items on a page of horizontal menus for lazy matching */
+#define LAZY_ITEMS        32
+
+/* Number of frames rendered by `--benchmark'; zero runs dmenu normally */
+static int benchmark_frames = 0;
+
+/* Number of items generated by `--train'; zero runs dmenu normally */
+static int train_items = 0;
+
+/* Daemon mode: serve menus, or act as client sending or showing item sets */
+static int daemon_mode = 0;
+static char *daemon_socket = NULL;
+static char *daemon_load_set = NULL;
+static char *daemon_show_set = NULL;
+
+/* Write per-keystroke statistics on exit to stderr or file */
+static int stats_enabled = 0;
+static char *stats_file = NULL;
+
+/* Record trace events and write them to file on exit or SIGUSR1 */
+static char *trace_file = NULL;
+
+/* Field delimiter, that may be given as escape sequence */
+static char *field_delimiter = NULL;
+
+/* Files and commands given by `--input' and `--input-cmd', in order */
+typedef struct
+{
+  char *arg;
+  int command;
+} dinput_t;
+
+static GArray *inputs = NULL;
+
+/* Source of items: `stdin', executables in `path' or `i3' commands */
+static char *item_source = "stdin";
+
+/* Run selection as i3 command using the connection of `--source=i3' */
+static int i3_exec = 0;
+static int i3_fd = -1;
+
+/* Sort order of items: `none', `lex', `natural', `length' or `locale' */
+static char *sort_order = "none";
+
+/* Match algorithm: `prefix', `strip-prefix', `regex' or `tokens' */
+static char *match_algorithm = "prefix";
+
+/* Regular expression engine: `posix' or `pcre' */
+static char *regex_engine = "posix";
+
+/* Match only the visible page first, the remaining items while idle */
+static int lazy_matching = 0;
+
+/* Maximum size of cached match sets in KiB */
+static int cache_size = 8192;
+
+/* Collect `--input' and `--input-cmd' in order of the command line */
+static gboolean dmenu_add_input(const gchar *option, const gchar *value, gpointer data, GError **error)
+{/*{{{*/
+  const dinput_t input = { .arg = g_strdup(value), .command = !strcmp(option, "--input-cmd") };
+
+  if(!inputs) inputs = g_array_new(FALSE, FALSE, sizeof(dinput_t));
+  g_array_append_val(inputs, input);
+
+  return TRUE;
+}/*}}}*/
+
+void dmenu_getopt(dx11_t *x, xcfg_t *model_config, xcmd_t *model, dview_t *view, dctrl_t *control, int argc, char *argv[])
 {/*{{{*/
   assert(x);
+  assert(model_config);
   assert(model);
   assert(view);
   assert(control);
-  xcfg_t model_config;
 
-  xcmd_config_default(&model_config);
+  xcmd_config_default(model_config);
 
   debug("Parse command line options.");
 
@@ -208,7 +283,9 @@ void dmenu_getopt(dx11_t *x, xcmd_t *model, dview_t *view, dctrl_t *control, int
   view->prompt.text = "~>";
   view->show_at_bottom = 0;
   view->single_column = 0;
+  view->use_shm = 0;
   control->fast_startup = 0;
+  char **fields = model_config->fields;
   // char *config_file = NULL;
 
   const GOptionEntry options[] = 
@@ -216,12 +293,38 @@ void dmenu_getopt(dx11_t *x, xcmd_t *model, dview_t *view, dctrl_t *control, int
     {"bottom",      'b', 0, G_OPTION_ARG_NONE,    &view->show_at_bottom,          "Place window at the bottom of the screen", NULL  },
     /* {"config",      'c', 0, G_OPTION_ARG_STRING,  &config_file,                   "Load configuration from FILE",             "FILE"}, */
     /* {"exec",        'e', 0, G_OPTION_ARG_STRING,  &control->exec,                 "Execute PROG using selection",             "PROG"}, */
-    {"ignore-case", 'i', 0, G_OPTION_ARG_NONE,    &model_config.case_insensitive, "Compare strings ignoring case",            NULL  },
-    {"fast",        'f', 0, G_OPTION_ARG_NONE,    &control->fast_startup,         "Read input after grabbing the keyboard",   NULL  },
+    {"ignore-case", 'i', 0, G_OPTION_ARG_NONE,    &model_config->case_insensitive, "Compare strings ignoring case",            NULL  },
+    {"fast",        'f', 0, G_OPTION_ARG_NONE,    &control->fast_startup,         "Ignored, input is read concurrently",      NULL  },
     {"lines",       'l', 0, G_OPTION_ARG_INT,     &view->menu.lines,              "Display input using N lines",              "N"   },
     {"prompt",      'p', 0, G_OPTION_ARG_STRING,  &view->prompt.text,             "Use STR as prompt message",                "STR" },
     {"monitor",     'm', 0, G_OPTION_ARG_INT,     &x->monitor,                    "Place window on screen ID",                "ID"  },
     {"single-column",0,  0, G_OPTION_ARG_NONE,    &view->single_column,           "Render items as single column view",       NULL  },
+    {"shm",          0,  0, G_OPTION_ARG_NONE,    &view->use_shm,                 "Render client-side into shared memory",    NULL  },
+    {"benchmark",    0,  0, G_OPTION_ARG_INT,     &benchmark_frames,              "Render N frames offscreen, report cost",   "N"   },
+    {"train",        0,  0, G_OPTION_ARG_INT,     &train_items,                   "Run headless training workload on N items", "N"  },
+    {"daemon",       0,  0, G_OPTION_ARG_NONE,    &daemon_mode,                   "Serve menus to clients",                   NULL  },
+    {"socket",       0,  0, G_OPTION_ARG_FILENAME,&daemon_socket,                 "Use PATH as socket of the daemon",         "PATH"},
+    {"load",         0,  0, G_OPTION_ARG_STRING,  &daemon_load_set,               "Send input to daemon as item set NAME",    "NAME"},
+    {"show",         0,  0, G_OPTION_ARG_STRING,  &daemon_show_set,               "Show item set NAME using the daemon",      "NAME"},
+    {"delimiter",    0,  0, G_OPTION_ARG_STRING,  &field_delimiter,               "Separate fields of items by CHAR",         "CHAR"},
+    {"display-fields",0, 0, G_OPTION_ARG_STRING,  &fields[xcmd_field_display],    "Display fields N, N-M or N- of items",     "N-M" },
+    {"match-fields", 0,  0, G_OPTION_ARG_STRING,  &fields[xcmd_field_match],      "Match input against fields N-M",           "N-M" },
+    {"output-fields",0,  0, G_OPTION_ARG_STRING,  &fields[xcmd_field_output],     "Print fields N-M of selection",            "N-M" },
+    {"print-index",  0,  0, G_OPTION_ARG_NONE,    &model_config->print_index,     "Print position of selection in input",     NULL  },
+    {"print-source", 0,  0, G_OPTION_ARG_NONE,    &model_config->print_source,    "Print input of selection before it",       NULL  },
+    {"unique",       0,  0, G_OPTION_ARG_NONE,    &model_config->unique,          "Drop duplicate items",                     NULL  },
+    {"match",        0,  0, G_OPTION_ARG_STRING,  &match_algorithm,               "Match by ALGO (prefix, strip-prefix, regex, tokens)", "ALGO"},
+    {"regex-engine", 0,  0, G_OPTION_ARG_STRING,  &regex_engine,                  "Match regex using ENGINE (posix, pcre)",   "ENGINE"},
+    {"lazy",         0,  0, G_OPTION_ARG_NONE,    &lazy_matching,                 "Match visible page first, the rest lazily", NULL  },
+    {"cache-size",   0,  0, G_OPTION_ARG_INT,     &cache_size,                    "Cache match sets in up to N KiB",          "N"   },
+    {"sort",         0,  0, G_OPTION_ARG_STRING,  &sort_order,                    "Sort by MODE (lex, natural, length, locale)", "MODE"},
+    {"source",       0,  0, G_OPTION_ARG_STRING,  &item_source,                   "Read items from NAME (stdin, path, i3)",   "NAME"},
+    {"input",        0,  0, G_OPTION_ARG_CALLBACK,(gpointer)dmenu_add_input,      "Read items from FILE, - is stdin",         "FILE"},
+    {"input-cmd",    0,  0, G_OPTION_ARG_CALLBACK,(gpointer)dmenu_add_input,      "Read items from output of CMD",            "CMD" },
+    {"i3-exec",      0,  0, G_OPTION_ARG_NONE,    &i3_exec,                       "Run selection as i3 command",              NULL  },
+    {"stats",        0,  0, G_OPTION_ARG_NONE,    &stats_enabled,                 "Print latency statistics on exit",         NULL  },
+    {"stats-file",   0,  0, G_OPTION_ARG_FILENAME,&stats_file,                    "Write latency statistics to FILE",         "FILE"},
+    {"trace",        0,  0, G_OPTION_ARG_FILENAME,&trace_file,                    "Write trace events to FILE",               "FILE"},
     {NULL,           0 , 0, 0,                    NULL,                           NULL,                                       NULL  }
   };
 
@@ -232,47 +335,357 @@ void dmenu_getopt(dx11_t *x, xcmd_t *model, dview_t *view, dctrl_t *control, int
   die_if(!g_option_context_parse(context, &argc, &argv, &error), "Option parsing failed: %s", error->message);
   g_option_context_free(context);
 
+  if(field_delimiter) {
+    gchar *delimiter = g_strcompress(field_delimiter);
+    die_if(1 != strlen(delimiter), "Delimiter must be a single byte: `%s'", field_delimiter);
+    model_config->delimiter = *delimiter;
+    g_free(delimiter);
+  } /* if ... */
+
+  if(stats_enabled || stats_file) stats_init(stats_file);
+  if(trace_file) trace_init(trace_file);
+
+  die_if(strcmp(item_source, "stdin") && strcmp(item_source, "path") && strcmp(item_source, "i3"), "Unknown source `%s'.", item_source);
+  die_if(i3_exec && strcmp(item_source, "i3"), "Option --i3-exec requires --source=i3.");
+  die_if(inputs && strcmp(item_source, "stdin"), "Options --input and --input-cmd require --source=stdin.");
+
+  const char *const sort_orders[] = { "none", "lex", "natural", "length", "locale", NULL };
+  const char *const *order = sort_orders;
+  while(*order && strcmp(*order, sort_order)) order += 1;
+  die_if(!*order, "Unknown sort order `%s'.", sort_order);
+  model_config->sort = (xsort_t)(order - sort_orders);
+
+  const char *const match_algorithms[] = { "prefix", "strip-prefix", "regex", "tokens", NULL };
+  const char *const *algorithm = match_algorithms;
+  while(*algorithm && strcmp(*algorithm, match_algorithm)) algorithm += 1;
+  die_if(!*algorithm, "Unknown match algorithm `%s'.", match_algorithm);
+  model_config->match = (xmatch_t)(algorithm - match_algorithms);
+
+  die_if(strcmp(regex_engine, "posix") && strcmp(regex_engine, "pcre"), "Unknown regular expression engine `%s'.", regex_engine);
+  model_config->regex = strcmp(regex_engine, "pcre") ? xcmd_regex_posix : xcmd_regex_pcre;
+
+  /* Horizontal menus show a few items per page, their number depends on
+   * the width of the items */
+  if(lazy_matching) model_config->page = view->menu.lines ? view->menu.lines : LAZY_ITEMS;
+
+  die_if(0 > cache_size, "Invalid cache size %i.", cache_size);
+  model_config->cache = (size_t)cache_size * 1024;
+
 	/* Apply model configuration */
-	xcmd_init(model, &model_config);
+	xcmd_init(model, model_config);
+
+}/*}}}*/
+
+/* Read all inputs concurrently, each on a thread of its own. Items are
+ * numbered in order of the command line. */
+void dmenu_read_inputs(xcmd_t *model)
+{/*{{{*/
+  assert(model);
+  assert(inputs);
+
+  FILE **streams = (FILE**)xmalloc(inputs->len * sizeof(FILE*));
+  guint i;
+
+  for(i = 0; i < inputs->len; i += 1) {
+    const dinput_t *input = &g_array_index(inputs, dinput_t, i);
+
+    if(input->command) {
+      streams[i] = popen(input->arg, "r");
+    } else if(!strcmp(input->arg, "-")) {
+      streams[i] = stdin;
+    } else {
+      streams[i] = fopen(input->arg, "r");
+    } /* if ... */
+
+    die_if(!streams[i], "Cannot read input `%s': %m", input->arg);
+  } /* for ... */
+
+  xcmd_read_streams(model, streams, inputs->len);
+
+  for(i = 0; i < inputs->len; i += 1) {
+    const dinput_t *input = &g_array_index(inputs, dinput_t, i);
+
+    if(input->command) {
+      const int status = pclose(streams[i]);
+      warn_if(status, "Command `%s' failed with status %i.", input->arg, status);
+    } else if(stdin != streams[i]) {
+      fclose(streams[i]);
+    } /* if ... */
+  } /* for ... */
+
+  free(streams);
+}/*}}}*/
+
+/* Read and index items from stdin, PATH or i3. This runs on its own thread
+ * and must not notify any observer. */
+gpointer dmenu_read_items(gpointer data)
+{/*{{{*/
+  xcmd_t *model = (xcmd_t*)data;
+  assert(model);
+  assert(!model->observer);
+  debug("Read items in background.");
+
+  if(!strcmp(item_source, "path")) {
+    source_path_read(model);
+
+  } else if(!strcmp(item_source, "i3")) {
+    /* Keep connection for running the selected command */
+    i3_fd = source_i3_connect();
+    source_i3_read(model, i3_fd);
+
+  } else if(inputs) {
+    dmenu_read_inputs(model);
 
+  } else {
+    xcmd_read_items(model, stdin);
+
+  } /* if ... */
+
+	xcmd_finish_items(model);
+
+  return NULL;
+}/*}}}*/
+
+/* Render frames without display, moving the selection by one item per frame,
+ * and report the cost per frame on stderr. */
+void dmenu_benchmark(xcmd_t *model, dview_t *view, int frames)
+{/*{{{*/
+  assert(model);
+  assert(view);
+  debug("Run benchmark with %i frames.", frames);
+
+  viewer_init_offscreen(view, BENCHMARK_WIDTH, BENCHMARK_HEIGHT, colors, fonts);
+	model->observer = (void(*)(void*,const xcmd_t*))viewer_update;
+	model->observer_data = view;
+
+  xcmd_read_items(model, stdin);
+	xcmd_finish_items(model);
+
+  const gint64 start = g_get_monotonic_time();
+  int i;
+
+  for(i = 0; i < frames; i += 1) {
+    xcmd_update_selected(model, +1, 1);
+
+    /* Render, even if the selection didn't change */
+    model->has_changed = 1;
+    xcmd_notify_observer(model);
+  } /* for ... */
+
+  const gint64 elapsed = g_get_monotonic_time() - start;
+  fprintf(stderr, "%i frames, %lu items: %.3f ms total, %.3f us/frame\n",
+      frames, model->matches.count, elapsed / 1000.0, frames ? (double)elapsed / frames : 0.0);
+}/*}}}*/
+
+/* Generate n items into a stream, optionally with tab-separated fields.
+ * Items are built from syllables using a fixed seed, so that every training
+ * run sees the same data. */
+static FILE *dmenu_train_items(int n, int with_fields, char **buffer, size_t *size)
+{/*{{{*/
+  const char *syllables[] =
+  {
+    "ba", "co", "de", "fi", "gu", "ka", "lo", "mi",
+    "nu", "pe", "ra", "si", "to", "vu", "xe", "zo"
+  };
+  guint32 seed = 2166136261u;
+  FILE *f = open_memstream(buffer, size);
+  int i, j;
+
+  for(i = 0; i < n; i += 1) {
+    char word[2][32];
+
+    for(j = 0; j < 2; j += 1) {
+      int k, len = 0;
+      seed = seed * 1664525u + 1013904223u;
+
+      for(k = 0; k < 2 + (int)(seed >> 29); k += 1) {
+        len += sprintf(word[j] + len, "%s", syllables[(seed >> (3 * k)) & 15]);
+      } /* for ... */
+    } /* for ... */
+
+    if(with_fields) {
+      fprintf(f, "%i\t%s-%s\t/usr/bin/%s\n", i, word[0], word[1], word[0]);
+    } else {
+      /* Some items have leading white space for strip-prefix matching */
+      fprintf(f, "%s%s%s%s\n", (seed & 64) ? "  " : "", word[0], (seed & 128) ? " " : "-", word[1]);
+    } /* if ... */
+  } /* for ... */
+
+  fclose(f);
+  return fmemopen(*buffer, *size, "r");
+}/*}}}*/
+
+/* Headless training workload for profile-guided optimization: ingest,
+ * every match mode, auto-complete and layout on generated data, rendered
+ * offscreen. */
+void dmenu_train(const xcfg_t *model_config, dview_t *view, int n_items)
+{/*{{{*/
+  assert(model_config);
+  assert(view);
+  debug("Run training workload on %i items.", n_items);
+
+  const xmatch_t modes[] = { xcmd_match_prefix, xcmd_match_strip_prefix, xcmd_match_regex, xcmd_match_tokens };
+  const int lines[] = { 0, 5, 20 };
+  const size_t n_modes = sizeof(modes) / sizeof(modes[0]);
+  const size_t n_lines = sizeof(lines) / sizeof(lines[0]);
+  size_t run;
+
+  view->menu.lines = lines[n_lines - 1];
+  viewer_init_offscreen(view, BENCHMARK_WIDTH, BENCHMARK_HEIGHT, colors, fonts);
+
+  /* Every match mode, case sensitive or not, with and without fields.
+   * Duplicates are dropped in case insensitive runs, every sort order is
+   * used, every third run matches lazily and regular expressions alternate
+   * between both engines. The cache of match sets is disabled in some runs
+   * and kept small in others, so entries are evicted. */
+  for(run = 0; run < 4 * n_modes; run += 1) {
+    xcfg_t config = *model_config;
+    xcmd_t model;
+    char *buffer = NULL;
+    size_t size = 0;
+    const int with_fields = run & 1;
+
+    config.match = modes[run / 4];
+    config.case_insensitive = (run >> 1) & 1;
+    config.unique = config.case_insensitive;
+    config.sort = (xsort_t)(run % (xcmd_sort_locale + 1));
+    config.page = (run % 3) ? 0 : lines[run % n_lines] + 1;
+    config.regex = with_fields ? xcmd_regex_pcre : xcmd_regex_posix;
+    config.cache = (run % 5) ? ((run % 5 == 1) ? 64 * 1024 : model_config->cache) : 0;
+    if(with_fields) config.fields[xcmd_field_display] = "2-";
+    if(with_fields) config.fields[xcmd_field_match] = "2";
+    if(with_fields) config.fields[xcmd_field_output] = "1";
+
+    FILE *f = dmenu_train_items(n_items, with_fields, &buffer, &size);
+    xcmd_init(&model, &config);
+    xcmd_read_items(&model, f);
+    xcmd_finish_items(&model);
+    fclose(f);
+
+    view->menu.lines = lines[run % n_lines];
+    view->single_column = (run / n_lines) & 1;
+    view->layout.valid = 0;
+    model.observer = (void(*)(void*,const xcmd_t*))viewer_update;
+    model.observer_data = view;
+
+    /* Type prefixes of some items and erase them again */
+    char query[64];
+    size_t i, k, n;
+
+    for(i = 0; i < 16; i += 1) {
+      const char *item = model.items.index[(i * 7919) % model.items.count];
+      const char *text = xcmd_item_field(&model, item, xcmd_field_match, &n);
+      n = min(n, sizeof(query) - 1);
+
+      for(k = 1; k <= n; k += 1) {
+        memcpy(query, text, k);
+        query[k] = '\0';
+        xcmd_update_matching(&model, query);
+        xcmd_update_selected(&model, +1, 1);
+        if(!(k % 3)) xcmd_auto_complete(&model);
+      } /* for ... */
+
+      for(k = n; 0 < k; k -= 1) {
+        query[k - 1] = '\0';
+        xcmd_update_matching(&model, query);
+      } /* for ... */
+
+      /* Select last item and print it */
+      xcmd_update_selected(&model, model.matches.count, 0);
+      if(model.matches.count) xcmd_item_output(&model, model.matches.index[model.matches.selected]);
+    } /* for ... */
+
+    xcmd_destroy(&model);
+    free(buffer);
+  } /* for ... */
+}/*}}}*/
+
+/* Run daemon or send a request to it */
+int dmenu_daemon(dx11_t *x, const xcfg_t *model_config, dview_t *view, dctrl_t *control)
+{/*{{{*/
+  char *path = daemon_socket ? g_strdup(daemon_socket) : daemon_default_path();
+  int status = 0;
+
+  if(daemon_load_set) {
+    status = daemon_client_load(path, daemon_load_set, stdin) ? 2 : 0;
+
+  } else if(daemon_show_set) {
+    status = daemon_client_show(path, daemon_show_set, view->prompt.text, stdout);
+    status = (0 > status) ? 2 : status;
+
+  } else {
+    ddaemon_t d;
+
+    /* Clients closing their connection early must not stop the daemon */
+    signal(SIGPIPE, SIG_IGN);
+
+    /* Keep everything resident, the window is mapped per request */
+    init_x11(x);
+    stats_sync_clock(x->display, x->root);
+    viewer_init(view, x, colors, fonts);
+    init_control(control, x, view->menu_hwnd);
+
+    die_if(daemon_init(&d, path, model_config, view, control), "Cannot start daemon at `%s'", path);
+    status = daemon_run(&d) ? 2 : 0;
+    daemon_destroy(&d);
+    stats_finish();
+
+    XCloseDisplay(x->display);
+
+  } /* if ... */
+
+  g_free(path);
+  return status;
 }/*}}}*/
 
 int main(int argc, char *argv[])
 {/*{{{*/
   dx11_t x = {0};
+  xcfg_t model_config;
   xcmd_t model;   /* M */
   dview_t view;   /* V */
   dctrl_t ctrl;   /* C */
 
   /* Configure MVC */
  //  dmenu_getopt(&x, &dmenu, &model, argc, argv);
-  dmenu_getopt(&x, &model, &view, &ctrl, argc, argv);
+  dmenu_getopt(&x, &model_config, &model, &view, &ctrl, argc, argv);
 
-  /* Setup callback functions for the model */
-	model.observer = (void(*)(void*,const xcmd_t*))viewer_update;
-	model.observer_data = &view;
+  if(0 < train_items) {
+    dmenu_train(&model_config, &view, train_items);
+    return 0;
+  } /* if ... */
+
+  if(0 < benchmark_frames) {
+    dmenu_benchmark(&model, &view, benchmark_frames);
+    return 0;
+  } /* if ... */
+
+  if(daemon_mode || daemon_load_set || daemon_show_set) {
+    return dmenu_daemon(&x, &model_config, &view, &ctrl);
+  } /* if ... */
+
+  /* Read and index items in the background, while connecting to X, loading
+   * fonts, mapping the window and grabbing the keyboard. */
+  GThread *reader = g_thread_new("reader", dmenu_read_items, &model);
 
   /* Initialize X window system */
   init_x11(&x);
+  stats_sync_clock(x.display, x.root);
 
   /* Setup the viewer */
 	viewer_init(&view, &x, colors, fonts);
+	viewer_show(&view);
+	init_control(&ctrl, &x, view.menu_hwnd);
+	die_if(control_grab_keyboard(&ctrl), "Cannot grab keyboard");
 
-  /* Load data and initialize controller. Flag fast_startup is set inside of
-   * dmenu_getopt */
-	if(ctrl.fast_startup) {
-	  debug("Perform fast start-up.");
-	  init_control(&ctrl, &x, view.menu_hwnd);
-	  xcmd_read_items(&model, stdin);
-
-	} else {
-	  debug("Perform normal start-up.");
-	  xcmd_read_items(&model, stdin);
-	  init_control(&ctrl, &x, view.menu_hwnd);
-
-	} /* if ... */
+  /* Items are first required for rendering */
+  g_thread_join(reader);
 
-	xcmd_finish_items(&model);
+  /* Setup callback functions for the model and show items */
+	model.observer = (void(*)(void*,const xcmd_t*))viewer_update;
+	model.observer_data = &view;
+	model.has_changed = 1;
+	xcmd_notify_observer(&model);
 
   /* Start event handling loop */
 	debug("Configuration is complete now.");
@@ -285,8 +698,11 @@ int main(int argc, char *argv[])
 	// drw_free(drw);
 	XSync(x.display, False);
 	XCloseDisplay(x.display);
+	stats_finish();
 
-	if(ctrl.result) {
+	if(ctrl.result && i3_exec) {
+	  return source_i3_exec(i3_fd, ctrl.result) ? 1 : 0;
+	} else if(ctrl.result) {
 	  printf("%s\n", ctrl.result);
 	} /* if ... */
 
@@ -25,7 +25,7 @@ void inputbuffer_destroy(inpbuf_t *in)
 gint inputbuffer_set(inpbuf_t *in, const gchar *str)
 {
   assert(in);
-  g_string_overwrite(in->text, 0, str);
+  g_string_assign(in->text, str);
   in->cursor.pos = g_utf8_strlen(in->text->str, -1);
   in->cursor.ptr = in->text->len;
 
@@ -0,0 +1,59 @@
+#ifndef DMENU_RENDER_H
+#define DMENU_RENDER_H
+#include "x.h"
+#include <glib.h>
+#include <stddef.h>
+
+typedef struct dmenu_render drender_t;
+typedef struct dmenu_render_ops drender_ops_t;
+typedef struct dmenu_font dfnt_t;
+
+struct dmenu_font
+{/*{{{*/
+	drender_t *render;  /* Backend, that loaded the font */
+	int height;
+	int ascent;
+	int padding;
+	XftFont *xfont; /* NULL, if the backend doesn't use Xft */
+	FcPattern *pattern;
+	int *advances;  /* Advances of code points below 256 cached by the viewer, -1 if unknown */
+	GHashTable *wide_advances; /* Advances of all other code points, plus one */
+	struct dmenu_font *next;
+	struct dmenu_font *prev;
+};/*}}}*/
+
+/* Drawing primitives of a render backend. All coordinates are given in
+ * viewer coordinates, i.e. relative to the root window. */
+struct dmenu_render_ops
+{/*{{{*/
+  const char *name;
+  dfnt_t *(*load_font)(drender_t *render, const char *fontname);
+  int  (*alloc_color)(drender_t *render, const char *colorname, XftColor *color);
+  int  (*text_width)(drender_t *render, const dfnt_t *font, const char *text, size_t n);
+  void (*fill_rect)(drender_t *render, const XftColor *color, int x, int y, int width, int height);
+  void (*draw_rect)(drender_t *render, const XftColor *color, int x, int y, int width, int height);
+  /* Draw text with baseline at y */
+  void (*draw_text)(drender_t *render, const dfnt_t *font, const XftColor *color, int x, int y, const char *text, size_t n);
+  /* Show region of the frame in window hwnd at its origin */
+  void (*present)(drender_t *render, Window hwnd, int x, int y, int width, int height);
+  void (*destroy)(drender_t *render);
+};/*}}}*/
+
+struct dmenu_render
+{/*{{{*/
+  const drender_ops_t *ops;
+  void *data; /* Backend specific state */
+};/*}}}*/
+
+/* Draw through Xlib and Xft into a pixmap of the size of the screen */
+void render_x11_init(drender_t *render, const dx11_t *x, Visual *visual, Colormap colormap);
+
+/* Rasterize client-side into a MIT-SHM image covering the given region. The
+ * new backend takes ownership of backend x11 and keeps using its fonts and
+ * colors. On failure a non-zero value is returned and x11 is left intact. */
+int render_shm_init(drender_t *render, drender_t *x11, const dx11_t *x, Visual *visual, int x_org, int y_org, int width, int height);
+
+/* Rasterize into a memory buffer without display. Fonts have fixed-width
+ * metrics; colors must be given as #RGB or #RRGGBB. */
+void render_offscreen_init(drender_t *render, int width, int height);
+#endif /* DMENU_RENDER_H */
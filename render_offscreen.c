@@ -0,0 +1,169 @@
+#include "render.h"
+#include "util.h"
+#include <glib.h>
+#include <string.h>
+
+/* Fixed-width font metrics */
+#define OFFSCREEN_FONT_HEIGHT   16
+#define OFFSCREEN_FONT_ASCENT   12
+#define OFFSCREEN_FONT_ADVANCE  8
+
+typedef struct render_offscreen roff_t;
+
+struct render_offscreen
+{/*{{{*/
+  int width;
+  int height;
+  guint32 *pixels;  /* width * height pixels, 0x00RRGGBB */
+  size_t frames;    /* Number of presented frames */
+};/*}}}*/
+
+static dfnt_t *render_offscreen_load_font(drender_t *render, const char *fontname)
+{/*{{{*/
+  assert(render);
+  debug("Load fixed-width font instead of `%s'.", fontname);
+
+	dfnt_t *font = xmalloc(sizeof(dfnt_t));
+	font->render = render;
+	font->xfont = NULL;
+	font->pattern = NULL;
+	font->height = OFFSCREEN_FONT_HEIGHT;
+	font->ascent = OFFSCREEN_FONT_ASCENT;
+	font->padding = font->height / 2;
+	font->advances = NULL;
+	font->wide_advances = NULL;
+	font->next = NULL;
+
+	return font;
+}/*}}}*/
+
+static int render_offscreen_alloc_color(drender_t *render, const char *colorname, XftColor *color)
+{/*{{{*/
+  assert(colorname);
+  assert(color);
+
+  const size_t n = strlen(colorname);
+  unsigned int rgb[3];
+  size_t i;
+
+  if(('#' != *colorname) || ((4 != n) && (7 != n))) return 0;
+
+  /* Expand each digit of #RGB to a full byte */
+  const size_t digits = (n - 1) / 3;
+
+  for(i = 0; i < 3; i += 1) {
+    char buf[3] = { 0 };
+    char *end = NULL;
+
+    memcpy(buf, colorname + 1 + i * digits, digits);
+    rgb[i] = strtoul(buf, &end, 16);
+    if(*end) return 0;
+
+    if(1 == digits) rgb[i] *= 0x11;
+  } /* for ... */
+
+  color->pixel = (rgb[0] << 16) | (rgb[1] << 8) | rgb[2];
+  color->color.red = rgb[0] * 0x101;
+  color->color.green = rgb[1] * 0x101;
+  color->color.blue = rgb[2] * 0x101;
+  color->color.alpha = 0xffff;
+
+  return 1;
+}/*}}}*/
+
+static int render_offscreen_text_width(drender_t *render, const dfnt_t *font, const char *text, size_t n)
+{/*{{{*/
+  return OFFSCREEN_FONT_ADVANCE * g_utf8_strlen(text, n);
+}/*}}}*/
+
+static void render_offscreen_fill_rect(drender_t *render, const XftColor *color, int x, int y, int width, int height)
+{/*{{{*/
+  assert(render);
+  roff_t *r = (roff_t*)render->data;
+
+  /* Clip rectangle on buffer */
+  const int x_lo = max(0, x);
+  const int y_lo = max(0, y);
+  const int x_hi = min(r->width, x + width);
+  const int y_hi = min(r->height, y + height);
+  const guint32 pixel = (guint32)color->pixel;
+  int i, j;
+
+  for(j = y_lo; j < y_hi; j += 1) {
+    guint32 *row = r->pixels + j * r->width;
+
+    for(i = x_lo; i < x_hi; i += 1) {
+      row[i] = pixel;
+    } /* for ... */
+  } /* for ... */
+}/*}}}*/
+
+static void render_offscreen_draw_rect(drender_t *render, const XftColor *color, int x, int y, int width, int height)
+{/*{{{*/
+  render_offscreen_fill_rect(render, color, x, y, width, 1);
+  render_offscreen_fill_rect(render, color, x, y + height - 1, width, 1);
+  render_offscreen_fill_rect(render, color, x, y, 1, height);
+  render_offscreen_fill_rect(render, color, x + width - 1, y, 1, height);
+}/*}}}*/
+
+/* Every visible glyph is drawn as a filled cell */
+static void render_offscreen_draw_text(drender_t *render, const dfnt_t *font, const XftColor *color, int x, int y, const char *text, size_t n)
+{/*{{{*/
+  const char *it = text;
+  const char *const end = text + n;
+
+  while(it < end) {
+    if(' ' != *it) render_offscreen_fill_rect(render, color, x + 1, y - font->ascent + 2, OFFSCREEN_FONT_ADVANCE - 2, font->ascent - 2);
+
+    it = g_utf8_next_char(it);
+    x += OFFSCREEN_FONT_ADVANCE;
+  } /* while ... */
+}/*}}}*/
+
+static void render_offscreen_present(drender_t *render, Window hwnd, int x, int y, int width, int height)
+{/*{{{*/
+  assert(render);
+  roff_t *r = (roff_t*)render->data;
+
+  r->frames += 1;
+}/*}}}*/
+
+static void render_offscreen_destroy(drender_t *render)
+{/*{{{*/
+  if(!render || !render->data) return;
+  roff_t *r = (roff_t*)render->data;
+
+  free(r->pixels);
+  free(r);
+  render->data = NULL;
+}/*}}}*/
+
+static const drender_ops_t render_offscreen_ops =
+{/*{{{*/
+  .name = "offscreen",
+  .load_font = render_offscreen_load_font,
+  .alloc_color = render_offscreen_alloc_color,
+  .text_width = render_offscreen_text_width,
+  .fill_rect = render_offscreen_fill_rect,
+  .draw_rect = render_offscreen_draw_rect,
+  .draw_text = render_offscreen_draw_text,
+  .present = render_offscreen_present,
+  .destroy = render_offscreen_destroy
+};/*}}}*/
+
+void render_offscreen_init(drender_t *render, int width, int height)
+{/*{{{*/
+  assert(render);
+  assert(0 < width);
+  assert(0 < height);
+  debug("Initialize offscreen render backend: width=%i, height=%i", width, height);
+
+  roff_t *r = (roff_t*)xmalloc(sizeof(roff_t));
+  r->width = width;
+  r->height = height;
+  r->pixels = (guint32*)xmalloc(width * height * sizeof(guint32));
+  r->frames = 0;
+
+  render->ops = &render_offscreen_ops;
+  render->data = r;
+}/*}}}*/
@@ -0,0 +1,266 @@
+#include "render.h"
+#include "util.h"
+
+typedef struct render_x11 rx11_t;
+typedef struct render_x11_batch rbatch_t;
+
+/* Filled rectangles of a single color, which are sent by a single request */
+struct render_x11_batch
+{/*{{{*/
+  unsigned long pixel;
+  GC gc;  /* Foreground is set to pixel once */
+  GArray *rects;  /* Pending XRectangle */
+};/*}}}*/
+
+struct render_x11
+{/*{{{*/
+  const dx11_t *x;  /* Handle to X window system */
+  Visual *visual;
+  Colormap colormap;
+  Pixmap pixmap;
+  GC gc;
+  XftDraw *draw;
+  GArray *batches;  /* rbatch_t of every color allocated */
+};/*}}}*/
+
+/* Get batch of the color, a GC is created for colors not allocated before */
+static rbatch_t *render_x11_batch(rx11_t *r, unsigned long pixel)
+{/*{{{*/
+  guint i;
+
+  for(i = 0; i < r->batches->len; i += 1) {
+    rbatch_t *batch = &g_array_index(r->batches, rbatch_t, i);
+    if(pixel == batch->pixel) return batch;
+  } /* for ... */
+
+  debug("Create GC for pixel %#lx.", pixel);
+  XGCValues values;
+  values.foreground = pixel;
+  values.line_width = 1;
+  values.line_style = LineSolid;
+  values.cap_style = CapButt;
+  values.join_style = JoinMiter;
+
+  rbatch_t batch;
+  batch.pixel = pixel;
+  batch.gc = XCreateGC(r->x->display, r->x->root, GCForeground | GCLineWidth | GCLineStyle | GCCapStyle | GCJoinStyle, &values);
+  batch.rects = g_array_new(FALSE, FALSE, sizeof(XRectangle));
+  r->batches = g_array_append_val(r->batches, batch);
+
+  return &g_array_index(r->batches, rbatch_t, r->batches->len - 1);
+}/*}}}*/
+
+/* Send all pending rectangles, a single request per color */
+static void render_x11_flush(rx11_t *r)
+{/*{{{*/
+  guint i;
+
+  for(i = 0; i < r->batches->len; i += 1) {
+    rbatch_t *batch = &g_array_index(r->batches, rbatch_t, i);
+    if(!batch->rects->len) continue;
+
+    XFillRectangles(r->x->display, r->pixmap, batch->gc, (XRectangle*)batch->rects->data, batch->rects->len);
+    batch->rects = g_array_set_size(batch->rects, 0);
+  } /* for ... */
+}/*}}}*/
+
+/* Check, if rectangle overlaps a pending one of another color */
+static int render_x11_overlaps(const rx11_t *r, unsigned long pixel, const XRectangle *rect)
+{/*{{{*/
+  guint i, j;
+
+  for(i = 0; i < r->batches->len; i += 1) {
+    const rbatch_t *batch = &g_array_index(r->batches, rbatch_t, i);
+    if(pixel == batch->pixel) continue;
+
+    for(j = 0; j < batch->rects->len; j += 1) {
+      const XRectangle *other = &g_array_index(batch->rects, XRectangle, j);
+
+      if(rect->x < other->x + other->width && other->x < rect->x + rect->width
+          && rect->y < other->y + other->height && other->y < rect->y + rect->height) return 1;
+    } /* for ... */
+  } /* for ... */
+
+  return 0;
+}/*}}}*/
+
+static dfnt_t *render_x11_load_xfont(drender_t *render, const char *fontname, FcPattern *fontpattern)
+{/*{{{*/
+  assert(render);
+
+  const rx11_t *r = (const rx11_t*)render->data;
+	dfnt_t *font;
+	XftFont *xfont = NULL;
+	FcPattern *pattern = NULL;
+
+	if (fontname) {
+		/* Using the pattern found at font->xfont->pattern does not yield the
+		 * same substitution results as using the pattern returned by
+		 * FcNameParse; using the latter results in the desired fallback
+		 * behaviour whereas the former just results in missing-character
+		 * rectangles being drawn, at least with some fonts. */
+		debug("Load font from name: `%s'.", fontname);
+
+		xfont = XftFontOpenName(r->x->display, r->x->screen, fontname);
+		warn_if(!xfont, "Cannot load font from name: `%s'", fontname);
+
+		if(!xfont) return NULL;
+
+    pattern = FcNameParse((FcChar8*)fontname);
+    warn_if(!pattern, "Cannot parse font name to pattern: `%s'", fontname);
+    
+    if(!pattern) {
+      XftFontClose(r->x->display, xfont);
+      return NULL;
+    } /* if ... */
+
+	} else if (fontpattern) {
+	  debug("Load font from pattern.");
+
+	  xfont = XftFontOpenPattern(r->x->display, fontpattern);
+	  warn_if(!xfont, "Cannot load font from pattern.");
+
+	  if(!xfont) return NULL;
+
+	} else {
+		die("No font specified.");
+	} /* if ... */
+
+  /* Allocate memory and initialize font font */
+	font = xmalloc(sizeof(dfnt_t));
+	font->render = render;
+	font->xfont = xfont;
+	font->pattern = pattern;
+	font->height = xfont->ascent + xfont->descent;
+	font->ascent = xfont->ascent;
+	font->padding = font->height / 2;
+	font->advances = NULL;
+	font->wide_advances = NULL;
+	font->next = NULL;
+
+	return font;
+}/*}}}*/
+
+static dfnt_t *render_x11_load_font(drender_t *render, const char *fontname)
+{/*{{{*/
+  return render_x11_load_xfont(render, fontname, NULL);
+}/*}}}*/
+
+static int render_x11_alloc_color(drender_t *render, const char *colorname, XftColor *color)
+{/*{{{*/
+  assert(render);
+  rx11_t *r = (rx11_t*)render->data;
+
+  if(!XftColorAllocName(r->x->display, r->visual, r->colormap, colorname, color)) return 0;
+
+  /* Every style gets its GC, before any frame is drawn */
+  render_x11_batch(r, color->pixel);
+  return 1;
+}/*}}}*/
+
+static int render_x11_text_width(drender_t *render, const dfnt_t *font, const char *text, size_t n)
+{/*{{{*/
+  assert(render);
+  const rx11_t *r = (const rx11_t*)render->data;
+
+  XGlyphInfo ext;
+	XftTextExtentsUtf8(r->x->display, font->xfont, (XftChar8 *)text, n, &ext);
+	trace("text_width", n, ext.xOff, 0);
+
+	return ext.xOff;
+}/*}}}*/
+
+/* Rectangles are collected per color until anything else is drawn. Those
+ * overlapping a rectangle of another color are sent in order. */
+static void render_x11_fill_rect(drender_t *render, const XftColor *color, int x, int y, int width, int height)
+{/*{{{*/
+  assert(render);
+  rx11_t *r = (rx11_t*)render->data;
+
+  const XRectangle rect = { .x = x, .y = y, .width = width, .height = height };
+  if(render_x11_overlaps(r, color->pixel, &rect)) render_x11_flush(r);
+
+  rbatch_t *batch = render_x11_batch(r, color->pixel);
+  batch->rects = g_array_append_val(batch->rects, rect);
+}/*}}}*/
+
+static void render_x11_draw_rect(drender_t *render, const XftColor *color, int x, int y, int width, int height)
+{/*{{{*/
+  assert(render);
+  rx11_t *r = (rx11_t*)render->data;
+
+  render_x11_flush(r);
+	XDrawRectangle(r->x->display, r->pixmap, render_x11_batch(r, color->pixel)->gc, x, y, width - 1, height - 1); 
+}/*}}}*/
+
+static void render_x11_draw_text(drender_t *render, const dfnt_t *font, const XftColor *color, int x, int y, const char *text, size_t n)
+{/*{{{*/
+  assert(render);
+  rx11_t *r = (rx11_t*)render->data;
+
+  render_x11_flush(r);
+	XftDrawStringUtf8(r->draw, color, font->xfont, x, y, (XftChar8*)text, n);
+}/*}}}*/
+
+static void render_x11_present(drender_t *render, Window hwnd, int x, int y, int width, int height)
+{/*{{{*/
+  assert(render);
+  rx11_t *r = (rx11_t*)render->data;
+
+  render_x11_flush(r);
+	XCopyArea(r->x->display, r->pixmap, hwnd, r->gc, x, y, width, height, 0, 0);
+	XSync(r->x->display, False);
+}/*}}}*/
+
+static void render_x11_destroy(drender_t *render)
+{/*{{{*/
+  if(!render || !render->data) return;
+  rx11_t *r = (rx11_t*)render->data;
+  guint i;
+
+  for(i = 0; i < r->batches->len; i += 1) {
+    rbatch_t *batch = &g_array_index(r->batches, rbatch_t, i);
+    XFreeGC(r->x->display, batch->gc);
+    g_array_free(batch->rects, TRUE);
+  } /* for ... */
+
+  g_array_free(r->batches, TRUE);
+  XftDrawDestroy(r->draw);
+  XFreeGC(r->x->display, r->gc);
+  XFreePixmap(r->x->display, r->pixmap);
+  free(r);
+  render->data = NULL;
+}/*}}}*/
+
+static const drender_ops_t render_x11_ops =
+{/*{{{*/
+  .name = "x11",
+  .load_font = render_x11_load_font,
+  .alloc_color = render_x11_alloc_color,
+  .text_width = render_x11_text_width,
+  .fill_rect = render_x11_fill_rect,
+  .draw_rect = render_x11_draw_rect,
+  .draw_text = render_x11_draw_text,
+  .present = render_x11_present,
+  .destroy = render_x11_destroy
+};/*}}}*/
+
+void render_x11_init(drender_t *render, const dx11_t *x, Visual *visual, Colormap colormap)
+{/*{{{*/
+  assert(render);
+  assert(x);
+  debug("Initialize X11 render backend.");
+
+  rx11_t *r = (rx11_t*)xmalloc(sizeof(rx11_t));
+  r->x = x;
+  r->visual = visual;
+  r->colormap = colormap;
+  r->pixmap = XCreatePixmap(x->display, x->root, x->width, x->height, x->depth);
+  r->gc = XCreateGC(x->display, x->root, 0, NULL);
+  XSetLineAttributes(x->display, r->gc, 1, LineSolid, CapButt, JoinMiter);
+  r->draw = XftDrawCreate(x->display, r->pixmap, visual, colormap);
+  r->batches = g_array_new(FALSE, FALSE, sizeof(rbatch_t));
+
+  render->ops = &render_x11_ops;
+  render->data = r;
+}/*}}}*/
@@ -0,0 +1,435 @@
+#include "render.h"
+#include "shm.h"
+#include "util.h"
+#ifdef MITSHM
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+/* Set by the error handler, if the X server cannot attach the segment */
+static int shm_attach_failed = 0;
+
+static int shm_error_handler(Display *display, XErrorEvent *ev)
+{/*{{{*/
+  shm_attach_failed = 1;
+  return 0;
+}/*}}}*/
+
+static void shm_glyph_free(gpointer data)
+{/*{{{*/
+  dglyph_t *glyph = (dglyph_t*)data;
+
+  free(glyph->coverage);
+  free(glyph);
+}/*}}}*/
+
+static void shm_font_free(gpointer data)
+{/*{{{*/
+  g_hash_table_destroy((GHashTable*)data);
+}/*}}}*/
+
+int shm_init(dshm_t *shm, const dx11_t *x, Visual *visual, int x_org, int y_org, int width, int height)
+{/*{{{*/
+  assert(shm);
+  assert(x);
+  assert(0 < width);
+  assert(0 < height);
+  debug("Initialize shared memory image: width=%i, height=%i", width, height);
+
+  const union { guint32 word; guint8 byte[4]; } host = { .word = 1 };
+  const int host_byte_order = host.byte[0] ? LSBFirst : MSBFirst;
+
+  shm->x = x;
+  shm->x_org = x_org;
+  shm->y_org = y_org;
+  shm->width = width;
+  shm->height = height;
+  shm->image = NULL;
+  shm->front = NULL;
+  shm->glyphs = NULL;
+
+  warn_if(!XShmQueryExtension(x->display), "Display doesn't support MIT-SHM.");
+  if(!XShmQueryExtension(x->display)) return -1;
+
+  /* Pixels are written as 32 bit words with 8 bit per channel */
+  warn_if(TrueColor != visual->class, "MIT-SHM requires a TrueColor visual.");
+  if(TrueColor != visual->class) return -1;
+
+  shm->image = XShmCreateImage(x->display, visual, x->depth, ZPixmap, NULL, &shm->info, width, height);
+  warn_if(!shm->image, "Cannot create shared memory image.");
+  if(!shm->image) return -1;
+
+  const int image_ok = (32 == shm->image->bits_per_pixel)
+      && (host_byte_order == shm->image->byte_order)
+      && (0xff0000 == shm->image->red_mask)
+      && (0x00ff00 == shm->image->green_mask)
+      && (0x0000ff == shm->image->blue_mask);
+
+  warn_if(!image_ok, "Unsupported pixel format for MIT-SHM: bits_per_pixel=%i", shm->image->bits_per_pixel);
+  if(!image_ok) {
+    XDestroyImage(shm->image);
+    shm->image = NULL;
+    return -1;
+  } /* if ... */
+
+  const size_t size = shm->image->bytes_per_line * height;
+  shm->info.shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+  warn_if(0 > shm->info.shmid, "Cannot create shared memory segment: %m");
+
+  if(0 > shm->info.shmid) {
+    XDestroyImage(shm->image);
+    shm->image = NULL;
+    return -1;
+  } /* if ... */
+
+  shm->info.shmaddr = (char*)shmat(shm->info.shmid, NULL, 0);
+  shm->info.readOnly = False;
+
+  /* Attaching fails asynchronously, e.g. for remote displays */
+  shm_attach_failed = ((char*)-1 == shm->info.shmaddr);
+
+  if(!shm_attach_failed) {
+    XErrorHandler old_handler = XSetErrorHandler(shm_error_handler);
+    XShmAttach(x->display, &shm->info);
+    XSync(x->display, False);
+    XSetErrorHandler(old_handler);
+  } /* if ... */
+
+  /* The segment is destroyed, after both sides have detached */
+  shmctl(shm->info.shmid, IPC_RMID, NULL);
+  warn_if(shm_attach_failed, "Cannot attach shared memory segment.");
+
+  if(shm_attach_failed) {
+    if((char*)-1 != shm->info.shmaddr) shmdt(shm->info.shmaddr);
+    XDestroyImage(shm->image);
+    shm->image = NULL;
+    return -1;
+  } /* if ... */
+
+  shm->image->data = shm->info.shmaddr;
+  shm->front = (char*)xmalloc(size);
+  memset(shm->image->data, 0, size);
+  memset(shm->front, 0, size);
+  shm->glyphs = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, shm_font_free);
+
+  return 0;
+}/*}}}*/
+
+void shm_destroy(dshm_t *shm)
+{/*{{{*/
+  if(!shm || !shm->image) return;
+
+  XShmDetach(shm->x->display, &shm->info);
+  shm->image->data = NULL;
+  XDestroyImage(shm->image);
+  shmdt(shm->info.shmaddr);
+  shm->image = NULL;
+
+  free(shm->front);
+  shm->front = NULL;
+
+  g_hash_table_destroy(shm->glyphs);
+  shm->glyphs = NULL;
+}/*}}}*/
+
+static inline guint32 *shm_row(dshm_t *shm, int y)
+{/*{{{*/
+  return (guint32*)(shm->image->data + y * shm->image->bytes_per_line);
+}/*}}}*/
+
+void shm_fill_rect(dshm_t *shm, const XftColor *color, int x, int y, int width, int height)
+{/*{{{*/
+  assert(shm);
+  assert(color);
+
+  /* Clip rectangle on image */
+  const int x_lo = max(0, x - shm->x_org);
+  const int y_lo = max(0, y - shm->y_org);
+  const int x_hi = min(shm->width, x - shm->x_org + width);
+  const int y_hi = min(shm->height, y - shm->y_org + height);
+  const guint32 pixel = (guint32)color->pixel;
+  int i, j;
+
+  for(j = y_lo; j < y_hi; j += 1) {
+    guint32 *row = shm_row(shm, j);
+
+    for(i = x_lo; i < x_hi; i += 1) {
+      row[i] = pixel;
+    } /* for ... */
+  } /* for ... */
+}/*}}}*/
+
+void shm_draw_rect(dshm_t *shm, const XftColor *color, int x, int y, int width, int height)
+{/*{{{*/
+  shm_fill_rect(shm, color, x, y, width, 1);
+  shm_fill_rect(shm, color, x, y + height - 1, width, 1);
+  shm_fill_rect(shm, color, x, y, 1, height);
+  shm_fill_rect(shm, color, x + width - 1, y, 1, height);
+}/*}}}*/
+
+/* Get cached glyph or render it using FreeType */
+static const dglyph_t *shm_get_glyph(dshm_t *shm, XftFont *font, FT_UInt index)
+{/*{{{*/
+  GHashTable *font_glyphs = (GHashTable*)g_hash_table_lookup(shm->glyphs, font);
+
+  if(!font_glyphs) {
+    font_glyphs = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, shm_glyph_free);
+    g_hash_table_insert(shm->glyphs, font, font_glyphs);
+  } /* if ... */
+
+  dglyph_t *glyph = (dglyph_t*)g_hash_table_lookup(font_glyphs, GUINT_TO_POINTER(index));
+  if(glyph) return glyph;
+
+  debug("Render glyph %u.", index);
+
+  /* Use the same advance as the text extents used for layout */
+  XGlyphInfo ext;
+  XftGlyphExtents(shm->x->display, font, &index, 1, &ext);
+
+  glyph = (dglyph_t*)xmalloc(sizeof(dglyph_t));
+  glyph->width = 0;
+  glyph->height = 0;
+  glyph->left = 0;
+  glyph->top = 0;
+  glyph->advance = ext.xOff;
+  glyph->coverage = NULL;
+
+  FT_Face face = XftLockFace(font);
+  warn_if(!face, "Cannot access font face.");
+
+  if(face && !FT_Load_Glyph(face, index, FT_LOAD_RENDER)) {
+    const FT_Bitmap *bitmap = &face->glyph->bitmap;
+    const int is_gray = (FT_PIXEL_MODE_GRAY == bitmap->pixel_mode);
+    const int is_mono = (FT_PIXEL_MODE_MONO == bitmap->pixel_mode);
+    int i, j;
+
+    warn_if(!is_gray && !is_mono, "Unsupported pixel mode of glyph %u.", index);
+
+    if(is_gray || is_mono) {
+      glyph->width = bitmap->width;
+      glyph->height = bitmap->rows;
+      glyph->left = face->glyph->bitmap_left;
+      glyph->top = face->glyph->bitmap_top;
+      glyph->coverage = (unsigned char*)xmalloc(glyph->width * glyph->height);
+
+      for(j = 0; j < glyph->height; j += 1) {
+        const unsigned char *src = bitmap->buffer + j * bitmap->pitch;
+        unsigned char *dst = glyph->coverage + j * glyph->width;
+
+        for(i = 0; i < glyph->width; i += 1) {
+          dst[i] = is_gray ? src[i] : ((src[i / 8] & (0x80 >> (i % 8))) ? 0xff : 0x00);
+        } /* for ... */
+      } /* for ... */
+    } /* if ... */
+  } /* if ... */
+
+  if(face) XftUnlockFace(font);
+
+  g_hash_table_insert(font_glyphs, GUINT_TO_POINTER(index), glyph);
+  return glyph;
+}/*}}}*/
+
+/* Blend color onto pixel using 8 bit coverage a */
+static inline guint32 shm_blend(guint32 pixel, const XftColor *color, const unsigned int a)
+{/*{{{*/
+  const unsigned int r = ((color->color.red   >> 8) * a + ((pixel >> 16) & 0xff) * (255 - a)) / 255;
+  const unsigned int g = ((color->color.green >> 8) * a + ((pixel >>  8) & 0xff) * (255 - a)) / 255;
+  const unsigned int b = ((color->color.blue  >> 8) * a + ((pixel >>  0) & 0xff) * (255 - a)) / 255;
+
+  return (pixel & 0xff000000) | (r << 16) | (g << 8) | b;
+}/*}}}*/
+
+void shm_draw_text(dshm_t *shm, XftFont *font, const XftColor *color, int x, int y, const char *text, size_t n)
+{/*{{{*/
+  assert(shm);
+  assert(font);
+  assert(color);
+
+  const char *it = text;
+  const char *const end = text + n;
+
+  /* Pen position in image coordinates; y is the baseline */
+  x -= shm->x_org;
+  y -= shm->y_org;
+
+  while(it < end) {
+    const FT_UInt index = XftCharIndex(shm->x->display, font, g_utf8_get_char(it));
+    const dglyph_t *glyph = shm_get_glyph(shm, font, index);
+    it = g_utf8_next_char(it);
+
+    /* Clip glyph on image */
+    const int x0 = x + glyph->left;
+    const int y0 = y - glyph->top;
+    const int i_lo = max(0, -x0);
+    const int j_lo = max(0, -y0);
+    const int i_hi = min(glyph->width, shm->width - x0);
+    const int j_hi = min(glyph->height, shm->height - y0);
+    int i, j;
+
+    for(j = j_lo; j < j_hi; j += 1) {
+      const unsigned char *src = glyph->coverage + j * glyph->width;
+      guint32 *dst = shm_row(shm, y0 + j) + x0;
+
+      for(i = i_lo; i < i_hi; i += 1) {
+        if(!src[i]) continue;
+        dst[i] = (0xff == src[i]) ? (guint32)color->pixel : shm_blend(dst[i], color, src[i]);
+      } /* for ... */
+    } /* for ... */
+
+    x += glyph->advance;
+  } /* while ... */
+}/*}}}*/
+
+void shm_present(dshm_t *shm, Drawable d, GC gc)
+{/*{{{*/
+  assert(shm);
+
+  const size_t row_size = shm->width * sizeof(guint32);
+  int x_lo = shm->width;
+  int x_hi = -1;
+  int y_lo = shm->height;
+  int y_hi = -1;
+  int j;
+
+  /* Find bounding box of pixels changed since the last frame */
+  for(j = 0; j < shm->height; j += 1) {
+    const guint32 *back = shm_row(shm, j);
+    guint32 *front = (guint32*)(shm->front + j * shm->image->bytes_per_line);
+    int lo = 0;
+    int hi = shm->width - 1;
+
+    if(!memcmp(back, front, row_size)) continue;
+
+    while(back[lo] == front[lo]) lo += 1;
+    while(back[hi] == front[hi]) hi -= 1;
+
+    x_lo = min(x_lo, lo);
+    x_hi = max(x_hi, hi);
+    y_lo = min(y_lo, j);
+    y_hi = j;
+
+    memcpy(front, back, row_size);
+  } /* for ... */
+
+  /* An unchanged frame is only requested to repair exposed regions */
+  if(0 > y_hi) {
+    x_lo = 0;
+    y_lo = 0;
+    x_hi = shm->width - 1;
+    y_hi = shm->height - 1;
+  } /* if ... */
+
+  debug("Present damaged region: x=%i, y=%i, width=%i, height=%i", x_lo, y_lo, 1 + x_hi - x_lo, 1 + y_hi - y_lo);
+
+  /* The image must not be modified until the server has processed the
+   * request, i.e. until the next XSync */
+  XShmPutImage(shm->x->display, d, gc, shm->image, x_lo, y_lo, x_lo, y_lo, 1 + x_hi - x_lo, 1 + y_hi - y_lo, False);
+}/*}}}*/
+
+/* Render backend: shared memory image, fonts and colors from X11 backend */
+typedef struct render_shm rshm_t;
+
+struct render_shm
+{/*{{{*/
+  dshm_t shm;
+  drender_t x11;
+  GC gc;
+};/*}}}*/
+
+static dfnt_t *render_shm_load_font(drender_t *render, const char *fontname)
+{/*{{{*/
+  rshm_t *r = (rshm_t*)render->data;
+  return r->x11.ops->load_font(&r->x11, fontname);
+}/*}}}*/
+
+static int render_shm_alloc_color(drender_t *render, const char *colorname, XftColor *color)
+{/*{{{*/
+  rshm_t *r = (rshm_t*)render->data;
+  return r->x11.ops->alloc_color(&r->x11, colorname, color);
+}/*}}}*/
+
+static int render_shm_text_width(drender_t *render, const dfnt_t *font, const char *text, size_t n)
+{/*{{{*/
+  rshm_t *r = (rshm_t*)render->data;
+  return r->x11.ops->text_width(&r->x11, font, text, n);
+}/*}}}*/
+
+static void render_shm_fill_rect(drender_t *render, const XftColor *color, int x, int y, int width, int height)
+{/*{{{*/
+  shm_fill_rect(&((rshm_t*)render->data)->shm, color, x, y, width, height);
+}/*}}}*/
+
+static void render_shm_draw_rect(drender_t *render, const XftColor *color, int x, int y, int width, int height)
+{/*{{{*/
+  shm_draw_rect(&((rshm_t*)render->data)->shm, color, x, y, width, height);
+}/*}}}*/
+
+static void render_shm_draw_text(drender_t *render, const dfnt_t *font, const XftColor *color, int x, int y, const char *text, size_t n)
+{/*{{{*/
+  shm_draw_text(&((rshm_t*)render->data)->shm, font->xfont, color, x, y, text, n);
+}/*}}}*/
+
+static void render_shm_present(drender_t *render, Window hwnd, int x, int y, int width, int height)
+{/*{{{*/
+  rshm_t *r = (rshm_t*)render->data;
+
+  /* The image always covers the whole menu */
+  shm_present(&r->shm, hwnd, r->gc);
+  XSync(r->shm.x->display, False);
+}/*}}}*/
+
+static void render_shm_destroy(drender_t *render)
+{/*{{{*/
+  if(!render || !render->data) return;
+  rshm_t *r = (rshm_t*)render->data;
+
+  XFreeGC(r->shm.x->display, r->gc);
+  shm_destroy(&r->shm);
+  r->x11.ops->destroy(&r->x11);
+  free(r);
+  render->data = NULL;
+}/*}}}*/
+
+static const drender_ops_t render_shm_ops =
+{/*{{{*/
+  .name = "shm",
+  .load_font = render_shm_load_font,
+  .alloc_color = render_shm_alloc_color,
+  .text_width = render_shm_text_width,
+  .fill_rect = render_shm_fill_rect,
+  .draw_rect = render_shm_draw_rect,
+  .draw_text = render_shm_draw_text,
+  .present = render_shm_present,
+  .destroy = render_shm_destroy
+};/*}}}*/
+
+int render_shm_init(drender_t *render, drender_t *x11, const dx11_t *x, Visual *visual, int x_org, int y_org, int width, int height)
+{/*{{{*/
+  assert(render);
+  assert(x11);
+  assert(x);
+  debug("Initialize MIT-SHM render backend.");
+
+  rshm_t *r = (rshm_t*)xmalloc(sizeof(rshm_t));
+
+  if(shm_init(&r->shm, x, visual, x_org, y_org, width, height)) {
+    free(r);
+    return -1;
+  } /* if ... */
+
+  r->x11 = *x11;
+  r->gc = XCreateGC(x->display, x->root, 0, NULL);
+
+  render->ops = &render_shm_ops;
+  render->data = r;
+
+  return 0;
+}/*}}}*/
+#else
+
+int render_shm_init(drender_t *render, drender_t *x11, const dx11_t *x, Visual *visual, int x_org, int y_org, int width, int height)
+{/*{{{*/
+  warning("MIT-SHM support is disabled.");
+  return -1;
+}/*}}}*/
+#endif /* MITSHM */
@@ -0,0 +1,52 @@
+#ifndef DMENU_SHM_H
+#define DMENU_SHM_H
+#include "x.h"
+#ifdef MITSHM
+#include <glib.h>
+#include <X11/extensions/XShm.h>
+
+typedef struct dmenu_shm dshm_t;
+typedef struct dmenu_glyph dglyph_t;
+
+/* Client-side rasterizer drawing into a shared memory image */
+struct dmenu_shm
+{/*{{{*/
+  const dx11_t *x;  /* Handle to X window system */
+
+  XShmSegmentInfo info;
+  XImage *image;  /* Back buffer shared with the X server */
+  char *front;    /* Copy of last presented frame */
+  int x_org;  /* Origin of the image in viewer coordinates */
+  int y_org;
+  int width;
+  int height;
+  GHashTable *glyphs; /* Rendered glyphs by font and glyph index */
+};/*}}}*/
+
+/* Coverage bitmap of a single glyph */
+struct dmenu_glyph
+{/*{{{*/
+  int width;
+  int height;
+  int left;     /* Horizontal offset from pen position */
+  int top;      /* Vertical offset from baseline */
+  int advance;
+  unsigned char *coverage;  /* 8 bit alpha, width * height */
+};/*}}}*/
+
+/* Create shared image of size width x height, where x_org and y_org are the
+ * viewer coordinates of its upper left corner. Returns zero on success. On
+ * failure, e.g. if the display doesn't support MIT-SHM or is remote, a
+ * non-zero value is returned and the caller should fall back to drawing
+ * through the protocol. */
+int  shm_init(dshm_t *shm, const dx11_t *x, Visual *visual, int x_org, int y_org, int width, int height);
+void shm_destroy(dshm_t *shm);
+
+void shm_fill_rect(dshm_t *shm, const XftColor *color, int x, int y, int width, int height);
+void shm_draw_rect(dshm_t *shm, const XftColor *color, int x, int y, int width, int height);
+void shm_draw_text(dshm_t *shm, XftFont *font, const XftColor *color, int x, int y, const char *text, size_t n);
+
+/* Put the region changed since the last call into drawable d */
+void shm_present(dshm_t *shm, Drawable d, GC gc);
+#endif /* MITSHM */
+#endif /* DMENU_SHM_H */
@@ -0,0 +1,41 @@
+#ifndef DMENU_SOURCE_H
+#define DMENU_SOURCE_H
+#include "xcmd.h"
+
+/** \brief Read executables found in \c PATH
+ *
+ * The function adds the names of all executable regular files (or symbolic
+ * links to them) found in the directories of the \c PATH environment
+ * variable to the model \c ptr, sorted and without duplicates. Directories
+ * are scanned in parallel. The result of each scan is cached on disk and
+ * reused as long as the modification time of the directory doesn't change.
+ * On success this function returns zero, otherwise a non-zero value is
+ * returned.
+ */
+int source_path_read(xcmd_t *ptr);
+
+/** \brief Connect to i3
+ *
+ * The function connects to the IPC socket of the i3 window manager given by
+ * the \c I3SOCK environment variable. On success the connected socket is
+ * returned, otherwise a negative value is returned.
+ */
+int source_i3_connect(void);
+
+/** \brief Read i3 commands
+ *
+ * The function queries workspaces and outputs of i3 using the connection \c
+ * fd, pipelining both requests, and adds the same set of commands as \c
+ * i3wm_commands.py to the model \c ptr, sorted and without duplicates. On
+ * success this function returns zero, otherwise a non-zero value is returned.
+ */
+int source_i3_read(xcmd_t *ptr, int fd);
+
+/** \brief Run an i3 command
+ *
+ * The function sends \c command to i3 using the connection \c fd, instead of
+ * spawning \c i3-msg. On success this function returns zero, otherwise a
+ * non-zero value is returned.
+ */
+int source_i3_exec(int fd, const char *command);
+#endif /* DMENU_SOURCE_H */
@@ -0,0 +1,432 @@
+#include "source.h"
+#include "util.h"
+#include <glib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* i3 IPC message header: magic string, payload length and message type */
+#define SOURCE_I3_MAGIC     "i3-ipc"
+#define SOURCE_I3_HEADER    (sizeof(SOURCE_I3_MAGIC) - 1 + 2 * sizeof(guint32))
+
+/* i3 IPC message types */
+#define SOURCE_I3_RUN_COMMAND     0
+#define SOURCE_I3_GET_WORKSPACES  1
+#define SOURCE_I3_GET_OUTPUTS     3
+
+typedef struct source_i3_json sjson_t;
+
+/* Cursor of the JSON scanner */
+struct source_i3_json
+{
+  const char *it;
+  const char *end;
+};
+
+static void source_i3_json_space(sjson_t *json)
+{
+  while((json->it < json->end) && strchr(" \t\r\n", *json->it)) {
+    json->it += 1;
+  } /* while ... */
+}
+
+/* Scan string and append its decoded value to str, unless str is NULL */
+static int source_i3_json_string(sjson_t *json, GString *str)
+{
+  if((json->it >= json->end) || ('"' != *json->it)) return -1;
+  json->it += 1;
+
+  while(json->it < json->end) {
+    const char c = *json->it;
+    json->it += 1;
+
+    if('"' == c) return 0;
+
+    if('\\' != c) {
+      if(str) g_string_append_c(str, c);
+      continue;
+    } /* if ... */
+
+    if(json->it >= json->end) return -1;
+    const char e = *json->it;
+    json->it += 1;
+
+    char u[8];
+    char hex[5];
+
+    switch(e) {
+      case 'b': u[0] = '\b'; u[1] = '\0'; break;
+      case 'f': u[0] = '\f'; u[1] = '\0'; break;
+      case 'n': u[0] = '\n'; u[1] = '\0'; break;
+      case 'r': u[0] = '\r'; u[1] = '\0'; break;
+      case 't': u[0] = '\t'; u[1] = '\0'; break;
+
+      case 'u':
+        if(4 > json->end - json->it) return -1;
+        memcpy(hex, json->it, 4);
+        hex[4] = '\0';
+        json->it += 4;
+        u[g_unichar_to_utf8(strtoul(hex, NULL, 16), u)] = '\0';
+        break;
+
+      default: u[0] = e; u[1] = '\0'; break;
+    } /* switch ... */
+
+    if(str) g_string_append(str, u);
+  } /* while ... */
+
+  return -1;
+}
+
+/* Skip any value; literals and numbers are appended to str, unless it is NULL */
+static int source_i3_json_skip(sjson_t *json, GString *str)
+{
+  source_i3_json_space(json);
+  if(json->it >= json->end) return -1;
+
+  /* Strings */
+  if('"' == *json->it) return source_i3_json_string(json, str);
+
+  /* Objects and arrays */
+  if(('{' == *json->it) || ('[' == *json->it)) {
+    const char close = ('{' == *json->it) ? '}' : ']';
+    json->it += 1;
+    source_i3_json_space(json);
+
+    if((json->it < json->end) && (close == *json->it)) {
+      json->it += 1;
+      return 0;
+    } /* if ... */
+
+    while(json->it < json->end) {
+      if('}' == close) {
+        if(source_i3_json_string(json, NULL)) return -1;
+        source_i3_json_space(json);
+        if((json->it >= json->end) || (':' != *json->it)) return -1;
+        json->it += 1;
+      } /* if ... */
+
+      if(source_i3_json_skip(json, NULL)) return -1;
+      source_i3_json_space(json);
+      if(json->it >= json->end) return -1;
+
+      const char c = *json->it;
+      json->it += 1;
+
+      if(close == c) return 0;
+      if(',' != c) return -1;
+      source_i3_json_space(json);
+    } /* while ... */
+
+    return -1;
+  } /* if ... */
+
+  /* Literals and numbers */
+  const char *begin = json->it;
+
+  while((json->it < json->end) && !strchr(",]} \t\r\n", *json->it)) {
+    json->it += 1;
+  } /* while ... */
+
+  if(str) g_string_append_len(str, begin, json->it - begin);
+  return (begin == json->it) ? -1 : 0;
+}
+
+/* Collect the values of key from all objects of the top-level array */
+static int source_i3_json_values(const char *data, size_t n, const char *key, GPtrArray *values)
+{
+  sjson_t json = { .it = data, .end = data + n };
+  GString *name = g_string_new(NULL);
+  int failed = 0;
+
+  source_i3_json_space(&json);
+  failed = (json.it >= json.end) || ('[' != *json.it);
+  if(!failed) json.it += 1;
+
+  while(!failed) {
+    source_i3_json_space(&json);
+    if((json.it < json.end) && (']' == *json.it)) break;
+    if((json.it >= json.end) || ('{' != *json.it)) {
+      failed = 1;
+      break;
+    } /* if ... */
+
+    json.it += 1;
+    source_i3_json_space(&json);
+
+    /* Members of a single object */
+    while(!failed && (json.it < json.end) && ('}' != *json.it)) {
+      g_string_truncate(name, 0);
+      failed = source_i3_json_string(&json, name);
+      source_i3_json_space(&json);
+      failed = failed || (json.it >= json.end) || (':' != *json.it);
+      if(failed) break;
+      json.it += 1;
+
+      if(!strcmp(key, name->str)) {
+        GString *value = g_string_new(NULL);
+        failed = source_i3_json_skip(&json, value);
+        g_ptr_array_add(values, g_string_free(value, FALSE));
+      } else {
+        failed = source_i3_json_skip(&json, NULL);
+      } /* if ... */
+
+      source_i3_json_space(&json);
+      if((json.it < json.end) && (',' == *json.it)) {
+        json.it += 1;
+        source_i3_json_space(&json);
+      } /* if ... */
+    } /* while ... */
+
+    failed = failed || (json.it >= json.end);
+    if(failed) break;
+    json.it += 1;
+
+    source_i3_json_space(&json);
+    if((json.it < json.end) && (',' == *json.it)) json.it += 1;
+  } /* while ... */
+
+  g_string_free(name, TRUE);
+  warn_if(failed, "Cannot parse reply of i3.");
+
+  return failed ? -1 : 0;
+}
+
+static int source_i3_send(int fd, const char *data, size_t n)
+{
+  while(n) {
+    const ssize_t n_bytes = write(fd, data, n);
+    if(0 >= n_bytes) return -1;
+
+    data += n_bytes;
+    n -= n_bytes;
+  } /* while ... */
+
+  return 0;
+}
+
+static int source_i3_receive(int fd, char *data, size_t n)
+{
+  while(n) {
+    const ssize_t n_bytes = read(fd, data, n);
+    if(0 >= n_bytes) return -1;
+
+    data += n_bytes;
+    n -= n_bytes;
+  } /* while ... */
+
+  return 0;
+}
+
+/* Append message of type with payload to buffer */
+static void source_i3_message(GString *buffer, guint32 type, const char *payload)
+{
+  const guint32 length = strlen(payload);
+
+  g_string_append_len(buffer, SOURCE_I3_MAGIC, sizeof(SOURCE_I3_MAGIC) - 1);
+  g_string_append_len(buffer, (const char*)&length, sizeof(length));
+  g_string_append_len(buffer, (const char*)&type, sizeof(type));
+  g_string_append_len(buffer, payload, length);
+}
+
+/* Receive reply of type. The NUL-terminated payload is returned and must be
+ * freed by the caller, or NULL on failure. */
+static char *source_i3_reply(int fd, guint32 type, guint32 *n)
+{
+  char header[SOURCE_I3_HEADER];
+  guint32 reply_type = 0;
+  const size_t magic_size = sizeof(SOURCE_I3_MAGIC) - 1;
+
+  if(source_i3_receive(fd, header, sizeof(header))) return NULL;
+  if(memcmp(header, SOURCE_I3_MAGIC, magic_size)) return NULL;
+
+  memcpy(n, header + magic_size, sizeof(guint32));
+  memcpy(&reply_type, header + magic_size + sizeof(guint32), sizeof(guint32));
+  warn_if(type != reply_type, "Unexpected reply of type %u from i3.", reply_type);
+  if(type != reply_type) return NULL;
+
+  char *payload = (char*)xmalloc(*n + 1);
+  *(payload + *n) = '\0';
+
+  if(source_i3_receive(fd, payload, *n)) {
+    free(payload);
+    return NULL;
+  } /* if ... */
+
+  return payload;
+}
+
+int source_i3_connect(void)
+{
+  const char *path = g_getenv("I3SOCK");
+  warn_if(!path, "I3SOCK is not set.");
+  if(!path) return -1;
+
+  debug("Connect to i3 at `%s'.", path);
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+
+  warn_if(sizeof(addr.sun_path) <= strlen(path), "Socket path is too long: `%s'", path);
+  if(sizeof(addr.sun_path) <= strlen(path)) return -1;
+  strcpy(addr.sun_path, path);
+
+  const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  warn_if(0 > fd, "Cannot create socket: %m");
+  if(0 > fd) return -1;
+
+  if(connect(fd, (struct sockaddr*)&addr, sizeof(addr))) {
+    warning("Cannot connect to i3 at `%s': %m", path);
+    close(fd);
+    return -1;
+  } /* if ... */
+
+  return fd;
+}
+
+/* Quote names containing spaces */
+static char *source_i3_name(const char *name)
+{
+  return strchr(name, ' ') ? g_strdup_printf("\"%s\"", name) : g_strdup(name);
+}
+
+static gint source_i3_compare(gconstpointer a, gconstpointer b)
+{
+  return strcmp(*(const char**)a, *(const char**)b);
+}
+
+int source_i3_read(xcmd_t *ptr, int fd)
+{
+  assert(ptr);
+  debug("Read items from i3.");
+
+  if(0 > fd) return -1;
+
+  /* Pipeline both requests, i3 replies in order */
+  GString *request = g_string_new(NULL);
+  source_i3_message(request, SOURCE_I3_GET_WORKSPACES, "");
+  source_i3_message(request, SOURCE_I3_GET_OUTPUTS, "");
+
+  const int send_failed = source_i3_send(fd, request->str, request->len);
+  g_string_free(request, TRUE);
+  warn_if(send_failed, "Cannot send request to i3: %m");
+  if(send_failed) return -1;
+
+  guint32 n_workspaces = 0;
+  guint32 n_outputs = 0;
+  char *workspaces = source_i3_reply(fd, SOURCE_I3_GET_WORKSPACES, &n_workspaces);
+  char *outputs = workspaces ? source_i3_reply(fd, SOURCE_I3_GET_OUTPUTS, &n_outputs) : NULL;
+  GPtrArray *ws_names = g_ptr_array_new_with_free_func(g_free);
+  GPtrArray *out_names = g_ptr_array_new_with_free_func(g_free);
+
+  int failed = !workspaces || !outputs
+      || source_i3_json_values(workspaces, n_workspaces, "name", ws_names)
+      || source_i3_json_values(outputs, n_outputs, "name", out_names);
+  warn_if(failed, "Cannot query workspaces and outputs of i3.");
+
+  free(workspaces);
+  free(outputs);
+
+  /* Same command set as i3wm_commands.py */
+  const char *directions[] = { "left", "right", "down", "up", NULL };
+  const char *static_commands[] = 
+  {
+    "rename workspace to ",
+    "layout default", "layout tabbed", "layout stacking", "layout splitv", "layout splith",
+    "layout toggle split", "layout toggle all",
+    "split vertical", "split horizontal", "split toggle",
+    "focus parent", "focus child", "focus floating", "focus tiling", "focus mode_toggle",
+    "border normal", "border pixel", "border none", "border toggle",
+    NULL
+  };
+  GPtrArray *commands = g_ptr_array_new_with_free_func(g_free);
+  const char **it;
+  guint i;
+
+  for(it = static_commands; *it; it += 1) {
+    g_ptr_array_add(commands, g_strdup(*it));
+  } /* for ... */
+
+  for(it = directions; *it; it += 1) {
+    g_ptr_array_add(commands, g_strdup_printf("move workspace to output %s", *it));
+    g_ptr_array_add(commands, g_strdup_printf("move %s", *it));
+    g_ptr_array_add(commands, g_strdup_printf("focus %s", *it));
+    g_ptr_array_add(commands, g_strdup_printf("focus output %s", *it));
+  } /* for ... */
+
+  for(i = 0; !failed && (i < ws_names->len); i += 1) {
+    char *name = source_i3_name((const char*)g_ptr_array_index(ws_names, i));
+    g_ptr_array_add(commands, g_strdup_printf("rename workspace %s to ", name));
+    g_ptr_array_add(commands, g_strdup_printf("move container to workspace %s", name));
+    g_ptr_array_add(commands, g_strdup_printf("workspace %s", name));
+    g_free(name);
+  } /* for ... */
+
+  for(i = 0; !failed && (i < out_names->len); i += 1) {
+    char *name = source_i3_name((const char*)g_ptr_array_index(out_names, i));
+    g_ptr_array_add(commands, g_strdup_printf("move workspace to output %s", name));
+    g_ptr_array_add(commands, g_strdup_printf("focus output %s", name));
+    g_free(name);
+  } /* for ... */
+
+  /* Add sorted and unique commands to the model */
+  const char *last = NULL;
+  g_ptr_array_sort(commands, source_i3_compare);
+
+  for(i = 0; i < commands->len; i += 1) {
+    const char *command = (const char*)g_ptr_array_index(commands, i);
+    if(last && !strcmp(last, command)) continue;
+
+    xcmd_add_item(ptr, command, strlen(command));
+    last = command;
+  } /* for ... */
+
+  g_ptr_array_free(commands, TRUE);
+  g_ptr_array_free(out_names, TRUE);
+  g_ptr_array_free(ws_names, TRUE);
+
+  return failed ? -1 : 0;
+}
+
+int source_i3_exec(int fd, const char *command)
+{
+  assert(command);
+  debug("Run i3 command `%s'.", command);
+
+  if(0 > fd) return -1;
+
+  GString *request = g_string_new(NULL);
+  source_i3_message(request, SOURCE_I3_RUN_COMMAND, command);
+
+  const int send_failed = source_i3_send(fd, request->str, request->len);
+  g_string_free(request, TRUE);
+  warn_if(send_failed, "Cannot send command to i3: %m");
+  if(send_failed) return -1;
+
+  guint32 n = 0;
+  char *reply = source_i3_reply(fd, SOURCE_I3_RUN_COMMAND, &n);
+  GPtrArray *success = g_ptr_array_new_with_free_func(g_free);
+  GPtrArray *errors = g_ptr_array_new_with_free_func(g_free);
+  int failed = !reply
+      || source_i3_json_values(reply, n, "success", success)
+      || source_i3_json_values(reply, n, "error", errors);
+  guint i;
+
+  for(i = 0; !failed && (i < success->len); i += 1) {
+    failed = strcmp("true", (const char*)g_ptr_array_index(success, i));
+  } /* for ... */
+
+  for(i = 0; i < errors->len; i += 1) {
+    warning("i3: %s", (const char*)g_ptr_array_index(errors, i));
+  } /* for ... */
+
+  warn_if(failed, "Cannot run i3 command `%s'.", command);
+
+  g_ptr_array_free(errors, TRUE);
+  g_ptr_array_free(success, TRUE);
+  free(reply);
+
+  return failed ? -1 : 0;
+}
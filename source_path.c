@@ -0,0 +1,365 @@
+#include "source.h"
+#include "util.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <glib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* Binary cache of directory contents, stored in native byte order */
+#define SOURCE_PATH_MAGIC   "dmenu-path-cache"
+#define SOURCE_PATH_VERSION 1
+
+typedef struct source_path_dir spdir_t;
+typedef struct source_path_job spjob_t;
+
+/* Executables of a single directory */
+struct source_path_dir
+{
+  char *path;
+  gint64 mtime_sec;   /* Modification time of directory */
+  gint64 mtime_nsec;
+  int valid;          /* Set, if names are up to date */
+  GString *names;     /* NUL-separated names of executables */
+  guint32 count;
+};
+
+/* Directories shared by all scanning threads */
+struct source_path_job
+{
+  GPtrArray *dirs;
+  volatile gint next; /* Next directory to scan */
+};
+
+/* Record returned by getdents64(2) */
+struct source_path_dirent64
+{
+  guint64 d_ino;
+  gint64 d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+static spdir_t *source_path_dir_new(const char *path)
+{
+  spdir_t *dir = (spdir_t*)xmalloc(sizeof(spdir_t));
+
+  dir->path = xstrdup(path);
+  dir->mtime_sec = 0;
+  dir->mtime_nsec = 0;
+  dir->valid = 0;
+  dir->names = g_string_new(NULL);
+  dir->count = 0;
+
+  return dir;
+}
+
+static void source_path_dir_free(gpointer data)
+{
+  spdir_t *dir = (spdir_t*)data;
+
+  free(dir->path);
+  g_string_free(dir->names, TRUE);
+  free(dir);
+}
+
+/* Test entry name of directory fd, using d_type to avoid syscalls */
+static int source_path_is_executable(int fd, const char *name, unsigned char type)
+{
+  struct stat st;
+
+  switch(type) {
+    /* Regular files don't need to be stat'ed */
+    case DT_REG: break;
+
+    /* Symbolic links must point to regular files */
+    case DT_LNK: /* fallthrough */
+    case DT_UNKNOWN:
+      if(fstatat(fd, name, &st, 0) || !S_ISREG(st.st_mode)) return 0;
+      break;
+
+    default: return 0;
+  } /* switch ... */
+
+  return !faccessat(fd, name, X_OK, 0);
+}
+
+static void source_path_scan(spdir_t *dir)
+{
+  assert(dir);
+  debug("Scan directory `%s'.", dir->path);
+
+  g_string_truncate(dir->names, 0);
+  dir->count = 0;
+  dir->valid = 1;
+
+  const int fd = open(dir->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  warn_if(0 > fd, "Cannot open directory `%s': %m", dir->path);
+  if(0 > fd) return;
+
+  char buffer[32768] __attribute__((aligned(8)));
+  long n_bytes;
+
+  while(0 < (n_bytes = syscall(SYS_getdents64, fd, buffer, sizeof(buffer)))) {
+    long offset = 0;
+
+    while(offset < n_bytes) {
+      const struct source_path_dirent64 *entry = (const struct source_path_dirent64*)(buffer + offset);
+      const char *name = entry->d_name;
+      offset += entry->d_reclen;
+
+      /* Skip `.' and `..' */
+      if(('.' == name[0]) && (!name[1] || (('.' == name[1]) && !name[2]))) continue;
+      if(!source_path_is_executable(fd, name, entry->d_type)) continue;
+
+      g_string_append_len(dir->names, name, strlen(name) + 1);
+      dir->count += 1;
+    } /* while ... */
+  } /* while ... */
+
+  warn_if(0 > n_bytes, "Cannot read directory `%s': %m", dir->path);
+  close(fd);
+}
+
+static gpointer source_path_worker(gpointer data)
+{
+  spjob_t *job = (spjob_t*)data;
+  guint i;
+
+  while((i = g_atomic_int_add(&job->next, 1)) < job->dirs->len) {
+    spdir_t *dir = (spdir_t*)g_ptr_array_index(job->dirs, i);
+    if(!dir->valid) source_path_scan(dir);
+  } /* while ... */
+
+  return NULL;
+}
+
+/* Copy n bytes from cache at *it to dst, unless that exceeds end */
+static int source_path_cache_get(const char **it, const char *end, void *dst, size_t n)
+{
+  if((size_t)(end - *it) < n) return -1;
+
+  memcpy(dst, *it, n);
+  *it += n;
+  return 0;
+}
+
+/* Load cached directories by path */
+static GHashTable *source_path_load_cache(const char *file)
+{
+  GHashTable *cache = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, source_path_dir_free);
+  gchar *data = NULL;
+  gsize size = 0;
+
+  if(!g_file_get_contents(file, &data, &size, NULL)) return cache;
+  debug("Load cache `%s'.", file);
+
+  const char *it = data;
+  const char *const end = data + size;
+  char magic[sizeof(SOURCE_PATH_MAGIC) - 1];
+  guint32 version = 0;
+  guint32 n_dirs = 0;
+  guint32 i;
+
+  int failed = source_path_cache_get(&it, end, magic, sizeof(magic))
+      || memcmp(magic, SOURCE_PATH_MAGIC, sizeof(magic))
+      || source_path_cache_get(&it, end, &version, sizeof(version))
+      || (SOURCE_PATH_VERSION != version)
+      || source_path_cache_get(&it, end, &n_dirs, sizeof(n_dirs));
+
+  for(i = 0; !failed && (i < n_dirs); i += 1) {
+    guint32 path_size = 0;
+    guint32 names_size = 0;
+    spdir_t *dir = source_path_dir_new("");
+
+    failed = source_path_cache_get(&it, end, &path_size, sizeof(path_size))
+        || ((size_t)(end - it) < path_size);
+
+    if(!failed) {
+      free(dir->path);
+      dir->path = xstrndup(it, path_size);
+      it += path_size;
+    } /* if ... */
+
+    failed = failed
+        || source_path_cache_get(&it, end, &dir->mtime_sec, sizeof(dir->mtime_sec))
+        || source_path_cache_get(&it, end, &dir->mtime_nsec, sizeof(dir->mtime_nsec))
+        || source_path_cache_get(&it, end, &dir->count, sizeof(dir->count))
+        || source_path_cache_get(&it, end, &names_size, sizeof(names_size))
+        || ((size_t)(end - it) < names_size);
+
+    if(failed) {
+      source_path_dir_free(dir);
+      break;
+    } /* if ... */
+
+    g_string_append_len(dir->names, it, names_size);
+    it += names_size;
+    dir->valid = 1;
+    g_hash_table_replace(cache, dir->path, dir);
+  } /* for ... */
+
+  warn_if(failed, "Ignore invalid cache `%s'.", file);
+  g_free(data);
+
+  return cache;
+}
+
+static void source_path_save_cache(const char *file, const GPtrArray *dirs)
+{
+  debug("Save cache `%s'.", file);
+
+  gchar *cache_dir = g_path_get_dirname(file);
+  gchar *tmp_file = g_strdup_printf("%s.%i", file, (int)getpid());
+  g_mkdir_with_parents(cache_dir, 0700);
+
+  FILE *f = fopen(tmp_file, "w");
+  warn_if(!f, "Cannot write cache `%s': %m", tmp_file);
+
+  if(f) {
+    const guint32 version = SOURCE_PATH_VERSION;
+    const guint32 n_dirs = dirs->len;
+    guint i;
+
+    fwrite(SOURCE_PATH_MAGIC, 1, sizeof(SOURCE_PATH_MAGIC) - 1, f);
+    fwrite(&version, sizeof(version), 1, f);
+    fwrite(&n_dirs, sizeof(n_dirs), 1, f);
+
+    for(i = 0; i < dirs->len; i += 1) {
+      const spdir_t *dir = (const spdir_t*)g_ptr_array_index(dirs, i);
+      const guint32 path_size = strlen(dir->path);
+      const guint32 names_size = dir->names->len;
+
+      fwrite(&path_size, sizeof(path_size), 1, f);
+      fwrite(dir->path, 1, path_size, f);
+      fwrite(&dir->mtime_sec, sizeof(dir->mtime_sec), 1, f);
+      fwrite(&dir->mtime_nsec, sizeof(dir->mtime_nsec), 1, f);
+      fwrite(&dir->count, sizeof(dir->count), 1, f);
+      fwrite(&names_size, sizeof(names_size), 1, f);
+      fwrite(dir->names->str, 1, names_size, f);
+    } /* for ... */
+
+    /* Replace cache atomically */
+    const int failed = ferror(f) | fclose(f);
+    warn_if(failed, "Cannot write cache `%s'.", tmp_file);
+
+    if(failed || rename(tmp_file, file)) unlink(tmp_file);
+  } /* if ... */
+
+  g_free(tmp_file);
+  g_free(cache_dir);
+}
+
+static gint source_path_compare(gconstpointer a, gconstpointer b)
+{
+  return strcmp(*(const char**)a, *(const char**)b);
+}
+
+int source_path_read(xcmd_t *ptr)
+{
+  assert(ptr);
+  debug("Read items from PATH.");
+
+  const char *env = g_getenv("PATH");
+  warn_if(!env, "PATH is not set.");
+  if(!env) return -1;
+
+  gchar **paths = g_strsplit(env, ":", -1);
+  gchar **it;
+  gchar *cache_file = g_build_filename(g_get_user_cache_dir(), "dmenu", "path.cache", NULL);
+  GHashTable *cache = source_path_load_cache(cache_file);
+  GHashTable *seen = g_hash_table_new(g_str_hash, g_str_equal);
+  GPtrArray *dirs = g_ptr_array_new_with_free_func(source_path_dir_free);
+  guint n_outdated = 0;
+  guint n_cached = g_hash_table_size(cache);
+
+  /* Reuse cached directories, that haven't been modified since */
+  for(it = paths; *it; it += 1) {
+    struct stat st;
+
+    if(!**it || g_hash_table_contains(seen, *it)) continue;
+    g_hash_table_insert(seen, *it, *it);
+
+    if(stat(*it, &st) || !S_ISDIR(st.st_mode)) continue;
+
+    spdir_t *dir = (spdir_t*)g_hash_table_lookup(cache, *it);
+
+    if(dir && (dir->mtime_sec == st.st_mtim.tv_sec) && (dir->mtime_nsec == st.st_mtim.tv_nsec)) {
+      g_hash_table_steal(cache, *it);
+      n_cached -= 1;
+
+    } else {
+      /* Use modification time prior to scanning, so that changes made while
+       * scanning invalidate the cache again */
+      dir = source_path_dir_new(*it);
+      dir->mtime_sec = st.st_mtim.tv_sec;
+      dir->mtime_nsec = st.st_mtim.tv_nsec;
+      n_outdated += 1;
+
+    } /* if ... */
+
+    g_ptr_array_add(dirs, dir);
+  } /* for ... */
+
+  debug("Found %u directories in PATH, %u of them outdated.", dirs->len, n_outdated);
+
+  /* Scan outdated directories in parallel; this thread is a worker, too */
+  if(n_outdated) {
+    const guint n_threads = min(g_get_num_processors(), n_outdated);
+    GThread **threads = (GThread**)xmalloc(n_threads * sizeof(GThread*));
+    spjob_t job = { .dirs = dirs, .next = 0 };
+    guint i;
+
+    for(i = 1; i < n_threads; i += 1) {
+      threads[i] = g_thread_new("path", source_path_worker, &job);
+    } /* for ... */
+
+    source_path_worker(&job);
+
+    for(i = 1; i < n_threads; i += 1) {
+      g_thread_join(threads[i]);
+    } /* for ... */
+
+    free(threads);
+  } /* if ... */
+
+  /* Directories were rescanned, added or removed */
+  if(n_outdated || n_cached) source_path_save_cache(cache_file, dirs);
+
+  /* Add sorted and unique names to the model */
+  GPtrArray *names = g_ptr_array_new();
+  const char *last = NULL;
+  guint i;
+
+  for(i = 0; i < dirs->len; i += 1) {
+    const spdir_t *dir = (const spdir_t*)g_ptr_array_index(dirs, i);
+    const char *name = dir->names->str;
+    const char *const end = dir->names->str + dir->names->len;
+
+    for(; name < end; name += strlen(name) + 1) {
+      g_ptr_array_add(names, (gpointer)name);
+    } /* for ... */
+  } /* for ... */
+
+  g_ptr_array_sort(names, source_path_compare);
+
+  for(i = 0; i < names->len; i += 1) {
+    const char *name = (const char*)g_ptr_array_index(names, i);
+    if(last && !strcmp(last, name)) continue;
+
+    xcmd_add_item(ptr, name, strlen(name));
+    last = name;
+  } /* for ... */
+
+  g_ptr_array_free(names, TRUE);
+  g_ptr_array_free(dirs, TRUE);
+  g_hash_table_destroy(seen);
+  g_hash_table_destroy(cache);
+  g_free(cache_file);
+  g_strfreev(paths);
+
+  return 0;
+}
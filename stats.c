@@ -0,0 +1,210 @@
+#include "stats.h"
+#include "util.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* Histograms use 8 linear sub-buckets per power of two, i.e. the relative
+ * error of percentiles is below 12.5%. Values below 8 are exact. */
+#define STATS_SUB_BUCKETS 8
+#define STATS_BUCKETS     (62 * STATS_SUB_BUCKETS)
+
+typedef struct dmenu_stats_histogram dshist_t;
+
+struct dmenu_stats_histogram
+{
+  guint64 buckets[STATS_BUCKETS];
+  guint64 count;
+  guint64 sum;
+  guint64 max;
+};
+
+static struct
+{
+  int enabled;
+  int active;         /* Set, while handling a keystroke */
+  char *file;
+  gint64 offset_ms;   /* Monotonic clock minus X server time */
+  int clock_synced;
+  gint64 keypress;    /* Start of handling the current keystroke */
+  gint64 presented;   /* Completion of the last frame */
+  dshist_t timers[dstats_timer_count];
+  guint64 counters[dstats_counter_count];
+} stats;
+
+static const char *stats_timer_names[dstats_timer_count] =
+{
+  "match", "complete", "render", "present", "latency"
+};
+
+static const char *stats_counter_names[dstats_counter_count] =
+{
+  "keystrokes", "items_scanned", "matches", "frames", "cache_hits",
+  "cache_prefix_hits", "cache_misses"
+};
+
+static size_t stats_bucket(guint64 value)
+{
+  if(STATS_SUB_BUCKETS > value) return value;
+
+  const int e = 63 - __builtin_clzll(value);
+  const size_t sub = (value >> (e - 3)) & (STATS_SUB_BUCKETS - 1);
+  return (e - 2) * STATS_SUB_BUCKETS + sub;
+}
+
+/* Largest value of bucket */
+static guint64 stats_bucket_limit(size_t bucket)
+{
+  if(STATS_SUB_BUCKETS > bucket) return bucket;
+
+  const int e = bucket / STATS_SUB_BUCKETS + 2;
+  const guint64 sub = bucket % STATS_SUB_BUCKETS;
+  return ((STATS_SUB_BUCKETS + sub + 1) << (e - 3)) - 1;
+}
+
+static guint64 stats_percentile(const dshist_t *hist, double p)
+{
+  const guint64 rank = (guint64)(p * hist->count + 0.5);
+  guint64 sum = 0;
+  size_t i;
+
+  for(i = 0; i < STATS_BUCKETS; i += 1) {
+    sum += hist->buckets[i];
+    if(sum && (sum >= rank)) return min(stats_bucket_limit(i), hist->max);
+  } /* for ... */
+
+  return hist->max;
+}
+
+void stats_init(const char *file)
+{
+  memset(&stats, 0, sizeof(stats));
+  stats.enabled = 1;
+  stats.file = file ? xstrdup(file) : NULL;
+}
+
+void stats_sync_clock(Display *display, Window root)
+{
+  assert(display);
+  if(!stats.enabled) return;
+
+  /* The server timestamps the PropertyNotify while processing the request,
+   * i.e. roughly in the middle of the round-trip */
+  XSetWindowAttributes attrs = { .event_mask = PropertyChangeMask };
+  Window w = XCreateWindow(display, root, 0, 0, 1, 1, 0, CopyFromParent, InputOnly, CopyFromParent, CWEventMask, &attrs);
+  XEvent ev;
+
+  const gint64 begin = stats_now();
+  XChangeProperty(display, w, XA_WM_NAME, XA_STRING, 8, PropModeReplace, (const unsigned char*)"", 0);
+  XWindowEvent(display, w, PropertyChangeMask, &ev);
+  const gint64 end = stats_now();
+
+  stats.offset_ms = (begin + end) / 2000000 - (gint64)ev.xproperty.time;
+  stats.clock_synced = 1;
+  XDestroyWindow(display, w);
+
+  debug("X server clock offset is %li ms, round-trip took %li us.", stats.offset_ms, (end - begin) / 1000);
+}
+
+gint64 stats_now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (gint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void stats_histogram_add(dshist_t *hist, guint64 value)
+{
+  hist->buckets[stats_bucket(value)] += 1;
+  hist->count += 1;
+  hist->sum += value;
+  hist->max = max(hist->max, value);
+}
+
+gint64 stats_record(dstimer_t timer, gint64 begin)
+{
+  const gint64 end = stats_now();
+
+  if(stats.active) stats_histogram_add(&stats.timers[timer], end - begin);
+  return end;
+}
+
+void stats_count(dscounter_t counter, guint64 n)
+{
+  if(stats.active) stats.counters[counter] += n;
+}
+
+void stats_presented(gint64 end)
+{
+  stats.presented = end;
+  stats_count(dstats_frames, 1);
+}
+
+void stats_keypress_begin(void)
+{
+  if(!stats.enabled) return;
+
+  stats.active = 1;
+  stats.keypress = stats_now();
+  stats_count(dstats_keystrokes, 1);
+}
+
+void stats_keypress_end(Time time)
+{
+  if(!stats.active) return;
+  stats.active = 0;
+
+  /* Only keystrokes, that resulted in a frame, have a latency. Timestamps of
+   * the X server are milliseconds wrapping around at 2^32. */
+  if(!stats.clock_synced || (stats.presented < stats.keypress)) return;
+
+  const guint32 server_now = (guint32)(stats.presented / 1000000 - stats.offset_ms);
+  const guint32 elapsed_ms = server_now - (guint32)time;
+  stats_histogram_add(&stats.timers[dstats_latency], (guint64)elapsed_ms * 1000000);
+}
+
+void stats_finish(void)
+{
+  if(!stats.enabled) return;
+
+  FILE *f = stats.file ? fopen(stats.file, "w") : stderr;
+  warn_if(!f, "Cannot write statistics to `%s': %m", stats.file);
+
+  if(f) {
+    int i;
+    size_t j;
+
+    fprintf(f, "{\n  \"counters\": {");
+    for(i = 0; i < dstats_counter_count; i += 1) {
+      fprintf(f, "%s\"%s\": %lu", i ? ", " : "", stats_counter_names[i], stats.counters[i]);
+    } /* for ... */
+    fprintf(f, "},\n  \"clock_offset_ms\": %li,\n  \"timers_us\": {\n", stats.clock_synced ? stats.offset_ms : 0);
+
+    for(i = 0; i < dstats_timer_count; i += 1) {
+      const dshist_t *hist = &stats.timers[i];
+      int first = 1;
+
+      fprintf(f, "    \"%s\": {\"count\": %lu, \"mean\": %.1f, \"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f, \"buckets\": [",
+          stats_timer_names[i], hist->count, hist->count ? hist->sum / 1e3 / hist->count : 0.0,
+          stats_percentile(hist, 0.5) / 1e3, stats_percentile(hist, 0.9) / 1e3,
+          stats_percentile(hist, 0.99) / 1e3, hist->max / 1e3);
+
+      /* Non-empty buckets as pairs of upper limit and count */
+      for(j = 0; j < STATS_BUCKETS; j += 1) {
+        if(!hist->buckets[j]) continue;
+
+        fprintf(f, "%s[%.1f, %lu]", first ? "" : ", ", stats_bucket_limit(j) / 1e3, hist->buckets[j]);
+        first = 0;
+      } /* for ... */
+
+      fprintf(f, "]}%s\n", (i + 1 < dstats_timer_count) ? "," : "");
+    } /* for ... */
+
+    fprintf(f, "  }\n}\n");
+    if(stderr != f) fclose(f);
+  } /* if ... */
+
+  free(stats.file);
+  stats.file = NULL;
+  stats.enabled = 0;
+}
@@ -0,0 +1,84 @@
+#ifndef DMENU_STATS_H
+#define DMENU_STATS_H
+#include "x.h"
+#include <glib.h>
+
+typedef enum dmenu_stats_timer dstimer_t;
+typedef enum dmenu_stats_counter dscounter_t;
+
+/** \brief Timers recorded per keystroke */
+enum dmenu_stats_timer
+{
+  /** \brief Time spent in \c xcmd_update_matching, without notification */
+  dstats_match,
+  /** \brief Time spent in \c xcmd_auto_complete */
+  dstats_complete,
+  /** \brief Time spent in \c viewer_update, without presenting the frame */
+  dstats_render,
+  /** \brief Time spent presenting the frame, i.e. flushing and syncing X */
+  dstats_present,
+  /** \brief Time from the X event timestamp to the presented frame */
+  dstats_latency,
+  dstats_timer_count
+};
+
+/** \brief Counters recorded per keystroke */
+enum dmenu_stats_counter
+{
+  /** \brief Number of keystrokes */
+  dstats_keystrokes,
+  /** \brief Number of items passed to the match function */
+  dstats_items_scanned,
+  /** \brief Number of matching items */
+  dstats_matches,
+  /** \brief Number of presented frames */
+  dstats_frames,
+  /** \brief Number of inputs restored from the cache of match sets */
+  dstats_cache_hits,
+  /** \brief Number of inputs matched against the cached matches of a prefix */
+  dstats_cache_prefix_hits,
+  /** \brief Number of inputs matched against all items despite the cache */
+  dstats_cache_misses,
+  dstats_counter_count
+};
+
+/** \brief Enable statistics
+ *
+ * Statistics are written as JSON to \c file on \c stats_finish, or to stderr
+ * if \c file is \c NULL. Until called, recording statistics is a no-op.
+ */
+void stats_init(const char *file);
+
+/** \brief Synchronize with the X server clock
+ *
+ * Measures the offset between the monotonic clock and the timestamps of the
+ * X server using a PropertyNotify round-trip on a temporary window. This is
+ * required for \c dstats_latency.
+ */
+void stats_sync_clock(Display *display, Window root);
+
+/** \brief Current time of the monotonic clock in nanoseconds */
+gint64 stats_now(void);
+
+/** \brief Record time elapsed since \c begin
+ *
+ * The time is only recorded while handling a keystroke. Returns the current
+ * time, so that timers can be chained.
+ */
+gint64 stats_record(dstimer_t timer, gint64 begin);
+
+/** \brief Increment counter by \c n while handling a keystroke */
+void stats_count(dscounter_t counter, guint64 n);
+
+/** \brief Mark a presented frame, that completed at time \c end */
+void stats_presented(gint64 end);
+
+/** \brief Start handling a keystroke */
+void stats_keypress_begin(void);
+
+/** \brief Finish handling a keystroke, that happened at X server time \c time */
+void stats_keypress_end(Time time);
+
+/** \brief Write statistics and disable them */
+void stats_finish(void);
+#endif /* DMENU_STATS_H */
@@ -2,10 +2,13 @@
 #include <sys/stat.h>
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 
 #include "arg.h"
@@ -13,13 +16,42 @@ char *argv0;
 
 #define FLAG(x)  (flag[(x)-'a'])
 
+/* flags which need the mode, size or times of a file */
+#define NEEDSTAT  (FLAG('g') || FLAG('n') || FLAG('o') || FLAG('s') || FLAG('u'))
+/* flags which need the type of a file */
+#define NEEDTYPE  (FLAG('b') || FLAG('c') || FLAG('d') || FLAG('f') || FLAG('p'))
+
+/* record returned by getdents64(2) */
+struct linux_dirent64 {
+	unsigned long long d_ino;
+	long long d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+
+/* output of a single argument, collected by the workers of -j */
+struct job {
+	const char *arg;
+	char *out;
+	size_t len, size;
+	int matched;
+	int done;
+};
+
 static void test(const char *, const char *);
+static int testat(int, const char *, unsigned char);
 static void usage(void);
 
 static int match = 0;
 static int flag[26];
 static struct stat old, new;
 
+static struct job *jobs;
+static int njobs, nextjob;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t jobdone = PTHREAD_COND_INITIALIZER;
+
 static void
 test(const char *path, const char *name)
 {
@@ -48,10 +80,165 @@ test(const char *path, const char *name)
 	}
 }
 
+/* same as test(), but relative to directory fd and issuing only the syscalls
+ * the flags need. type is the d_type of name, or DT_UNKNOWN. */
+static int
+testat(int fd, const char *name, unsigned char type)
+{
+	struct stat st;
+	mode_t mode = 0;
+	int amode = 0;
+
+	if (!FLAG('a') && name[0] == '.')                         /* hidden files      */
+		return FLAG('v');
+
+	/* like stat(), this fails for dangling symbolic links */
+	if (type == DT_UNKNOWN || type == DT_LNK || NEEDSTAT) {
+		if (fstatat(fd, name, &st, 0))
+			return FLAG('v');
+		mode = st.st_mode;
+	} else if (NEEDTYPE) {
+		mode = DTTOIF(type);
+	}
+	if (FLAG('h') && type == DT_UNKNOWN) {
+		struct stat ln;
+		if (!fstatat(fd, name, &ln, AT_SYMLINK_NOFOLLOW))
+			type = IFTODT(ln.st_mode);
+	}
+
+	/* a single faccessat(2) checks all permissions at once */
+	if (FLAG('r')) amode |= R_OK;
+	if (FLAG('w')) amode |= W_OK;
+	if (FLAG('x')) amode |= X_OK;
+
+	return ((!FLAG('b') || S_ISBLK(mode))                         /* block special     */
+	&& (!FLAG('c') || S_ISCHR(mode))                              /* character special */
+	&& (!FLAG('d') || S_ISDIR(mode))                              /* directory         */
+	&& (!FLAG('f') || S_ISREG(mode))                              /* regular file      */
+	&& (!FLAG('g') || mode & S_ISGID)                             /* set-group-id flag */
+	&& (!FLAG('h') || type == DT_LNK)                             /* symbolic link     */
+	&& (!FLAG('n') || st.st_mtime > new.st_mtime)                 /* newer than file   */
+	&& (!FLAG('o') || st.st_mtime < old.st_mtime)                 /* older than file   */
+	&& (!FLAG('p') || S_ISFIFO(mode))                             /* named pipe        */
+	&& (!FLAG('s') || st.st_size > 0)                             /* not empty         */
+	&& (!FLAG('u') || mode & S_ISUID)                             /* set-user-id flag  */
+	&& (!amode || faccessat(fd, name, amode, AT_EACCESS) == 0))   /* permissions       */
+	!= FLAG('v');
+}
+
+static void
+output(struct job *job, const char *name)
+{
+	size_t n = strlen(name) + 1;
+
+	if (FLAG('q'))
+		exit(0);
+	job->matched = 1;
+	if (job->len + n > job->size) {
+		job->size = 2 * (job->len + n) + 4096;
+		if (!(job->out = realloc(job->out, job->size))) {
+			perror("realloc");
+			exit(2);
+		}
+	}
+	memcpy(job->out + job->len, name, n - 1);
+	job->out[job->len + n - 1] = '\n';
+	job->len += n;
+}
+
+static void
+run(struct job *job)
+{
+	struct linux_dirent64 *d;
+	char buf[32768] __attribute__((aligned(8)));
+	long n, off;
+	int fd;
+
+	if (!FLAG('l') || (fd = open(job->arg, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0) {
+		if (testat(AT_FDCWD, job->arg, DT_UNKNOWN))
+			output(job, job->arg);
+		return;
+	}
+	/* test directory contents */
+	while ((n = syscall(SYS_getdents64, fd, buf, sizeof buf)) > 0) {
+		for (off = 0; off < n; off += d->d_reclen) {
+			d = (struct linux_dirent64 *)(buf + off);
+			if (testat(fd, d->d_name, d->d_type))
+				output(job, d->d_name);
+		}
+	}
+	close(fd);
+}
+
+static void *
+worker(void *arg)
+{
+	int i;
+
+	for (;;) {
+		pthread_mutex_lock(&lock);
+		i = nextjob++;
+		pthread_mutex_unlock(&lock);
+		if (i >= njobs)
+			return NULL;
+
+		run(&jobs[i]);
+
+		pthread_mutex_lock(&lock);
+		jobs[i].done = 1;
+		pthread_cond_broadcast(&jobdone);
+		pthread_mutex_unlock(&lock);
+	}
+}
+
+/* test arguments on nthreads threads, printing results in argument order */
+static void
+parallel(int nthreads, int argc, char *argv[])
+{
+	pthread_t *threads;
+	int i;
+
+	if (nthreads <= 0)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nthreads > argc)
+		nthreads = argc;
+	if (nthreads < 1)
+		nthreads = 1;
+
+	njobs = argc;
+	if (!(jobs = calloc(argc, sizeof(*jobs))) ||
+	    !(threads = calloc(nthreads, sizeof(*threads)))) {
+		perror("calloc");
+		exit(2);
+	}
+	for (i = 0; i < argc; i++)
+		jobs[i].arg = argv[i];
+	for (i = 0; i < nthreads; i++) {
+		if (pthread_create(&threads[i], NULL, worker, NULL)) {
+			perror("pthread_create");
+			exit(2);
+		}
+	}
+	for (i = 0; i < argc; i++) {
+		pthread_mutex_lock(&lock);
+		while (!jobs[i].done)
+			pthread_cond_wait(&jobdone, &lock);
+		pthread_mutex_unlock(&lock);
+
+		fwrite(jobs[i].out, 1, jobs[i].len, stdout);
+		match |= jobs[i].matched;
+		free(jobs[i].out);
+	}
+	for (i = 0; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+	free(jobs);
+}
+
 static void
 usage(void)
 {
-	fprintf(stderr, "usage: %s [-abcdefghlpqrsuvwx] "
+	fprintf(stderr, "usage: %s [-abcdefghlpqrsuvwx] [-j jobs] "
 	        "[-n file] [-o file] [file...]\n", argv0);
 	exit(2); /* like test(1) return > 1 on error */
 }
@@ -64,9 +251,12 @@ main(int argc, char *argv[])
 	size_t linesiz = 0;
 	ssize_t n;
 	DIR *dir;
-	int r;
+	int r, nthreads = -1;
 
 	ARGBEGIN {
+	case 'j': /* test arguments in parallel */
+		nthreads = atoi(EARGF(usage()));
+		break;
 	case 'n': /* newer than file */
 	case 'o': /* older than file */
 		file = EARGF(usage());
@@ -89,6 +279,8 @@ main(int argc, char *argv[])
 			test(line, line);
 		}
 		free(line);
+	} else if (nthreads >= 0) {
+		parallel(nthreads, argc, argv);
 	} else {
 		for (; argc; argc--, argv++) {
 			if (FLAG('l') && (dir = opendir(*argv))) {
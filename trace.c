@@ -0,0 +1,188 @@
+#include "trace.h"
+#include "util.h"
+#include <fcntl.h>
+#include <glib.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Number of events per thread, must be a power of two */
+#define TRACE_EVENTS  16384
+/* Maximum number of sites; the last one collects all further sites */
+#define TRACE_SITES   4096
+
+#define TRACE_MAGIC   "dmenutrc"
+#define TRACE_VERSION 1
+
+typedef struct dmenu_trace_event dtevent_t;
+typedef struct dmenu_trace_ring dtring_t;
+
+/* Binary event, as written to the trace file */
+struct dmenu_trace_event
+{
+  uint64_t time;  /* Monotonic clock in nanoseconds */
+  uint32_t site;
+  uint32_t kind;
+  int64_t args[3];
+};
+
+struct dmenu_trace_ring
+{
+  uint32_t tid;
+  volatile uint64_t head; /* Number of events ever recorded */
+  dtevent_t events[TRACE_EVENTS];
+  dtring_t *next;
+};
+
+struct dmenu_trace_site
+{
+  const char *file;
+  const char *name;
+  int line;
+};
+
+int trace_enabled = 0;
+
+static char *trace_file = NULL;
+static struct dmenu_trace_site trace_sites[TRACE_SITES];
+static volatile unsigned int trace_n_sites = 0;
+static dtring_t *volatile trace_rings = NULL;
+static GMutex trace_lock;
+static __thread dtring_t *trace_ring = NULL;
+
+static void trace_on_signal(int signum)
+{
+  trace_dump();
+}
+
+void trace_init(const char *file)
+{
+  assert(file);
+
+  trace_file = xstrdup(file);
+  atexit(trace_dump);
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = trace_on_signal;
+  sa.sa_flags = SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGUSR1, &sa, NULL);
+
+  trace_enabled = 1;
+}
+
+unsigned int trace_register(const char *file, int line, const char *name)
+{
+  g_mutex_lock(&trace_lock);
+
+  /* Ids start at 1, as 0 marks unregistered sites */
+  unsigned int id = min(trace_n_sites + 1, TRACE_SITES - 1);
+
+  if(id > trace_n_sites) {
+    trace_sites[id].file = (TRACE_SITES - 1 > id) ? file : "";
+    trace_sites[id].name = (TRACE_SITES - 1 > id) ? name : "overflow";
+    trace_sites[id].line = (TRACE_SITES - 1 > id) ? line : 0;
+    trace_n_sites = id;
+  } /* if ... */
+
+  g_mutex_unlock(&trace_lock);
+  return id;
+}
+
+static dtring_t *trace_ring_new(void)
+{
+  dtring_t *ring = (dtring_t*)xmalloc(sizeof(dtring_t));
+
+  ring->tid = syscall(SYS_gettid);
+  ring->head = 0;
+
+  g_mutex_lock(&trace_lock);
+  ring->next = trace_rings;
+  trace_rings = ring;
+  g_mutex_unlock(&trace_lock);
+
+  return ring;
+}
+
+void trace_record(unsigned int id, dtrace_kind_t kind, int64_t a, int64_t b, int64_t c)
+{
+  if(!trace_ring) trace_ring = trace_ring_new();
+
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  dtevent_t *event = trace_ring->events + (trace_ring->head & (TRACE_EVENTS - 1));
+  event->time = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+  event->site = id;
+  event->kind = kind;
+  event->args[0] = a;
+  event->args[1] = b;
+  event->args[2] = c;
+  trace_ring->head += 1;
+}
+
+static int trace_write(int fd, const void *data, size_t n)
+{
+  const char *it = (const char*)data;
+
+  while(n) {
+    const ssize_t n_bytes = write(fd, it, n);
+    if(0 >= n_bytes) return -1;
+
+    it += n_bytes;
+    n -= n_bytes;
+  } /* while ... */
+
+  return 0;
+}
+
+static int trace_write_string(int fd, const char *str)
+{
+  const uint32_t n = strlen(str);
+  return trace_write(fd, &n, sizeof(n)) || trace_write(fd, str, n);
+}
+
+/* Format: magic, version, sites (line, file, name), rings (tid, number of
+ * events, events in chronological order) until end of file. Strings are
+ * prefixed by their length, integers are in native byte order. */
+void trace_dump(void)
+{
+  if(!trace_file) return;
+
+  const int fd = open(trace_file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if(0 > fd) return;
+
+  const uint32_t version = TRACE_VERSION;
+  const uint32_t n_sites = trace_n_sites;
+  uint32_t i;
+  int failed = trace_write(fd, TRACE_MAGIC, sizeof(TRACE_MAGIC) - 1)
+      || trace_write(fd, &version, sizeof(version))
+      || trace_write(fd, &n_sites, sizeof(n_sites));
+
+  for(i = 1; !failed && (i <= n_sites); i += 1) {
+    const uint32_t line = trace_sites[i].line;
+
+    failed = trace_write(fd, &line, sizeof(line))
+        || trace_write_string(fd, trace_sites[i].file)
+        || trace_write_string(fd, trace_sites[i].name);
+  } /* for ... */
+
+  const dtring_t *ring;
+
+  for(ring = trace_rings; !failed && ring; ring = ring->next) {
+    const uint64_t head = ring->head;
+    const uint32_t n_events = min(head, TRACE_EVENTS);
+    const uint32_t first = (head - n_events) & (TRACE_EVENTS - 1);
+    const uint32_t n_tail = min(n_events, TRACE_EVENTS - first);
+
+    failed = trace_write(fd, &ring->tid, sizeof(ring->tid))
+        || trace_write(fd, &n_events, sizeof(n_events))
+        || trace_write(fd, ring->events + first, n_tail * sizeof(dtevent_t))
+        || trace_write(fd, ring->events, (n_events - n_tail) * sizeof(dtevent_t));
+  } /* for ... */
+
+  close(fd);
+}
@@ -0,0 +1,63 @@
+#ifndef DMENU_TRACE_H
+#define DMENU_TRACE_H
+#include <stdint.h>
+
+typedef enum dmenu_trace_kind dtrace_kind_t;
+
+/** \brief Kind of trace events */
+enum dmenu_trace_kind
+{
+  /** \brief Single point in time */
+  dtrace_instant,
+  /** \brief Start of a span, closed by \c dtrace_end of the same thread */
+  dtrace_begin,
+  /** \brief End of a span */
+  dtrace_end
+};
+
+/** \brief Runtime switch
+ *
+ * Events are only recorded, while this is non-zero. Checking it is the only
+ * cost of a disabled trace point.
+ */
+extern int trace_enabled;
+
+/* Record event of kind at the calling site. The site is registered once on
+ * its first event; name must be a string literal. */
+#define TRACE_EVENT(kind, name, a, b, c) \
+  { \
+    if(trace_enabled) { \
+      static unsigned int trace_site_ = 0; \
+      if(!trace_site_) trace_site_ = trace_register(__FILE__, __LINE__, (name)); \
+      trace_record(trace_site_, (kind), (a), (b), (c)); \
+    } \
+  }
+
+/* Record instant event name with up to three integer arguments */
+#define trace(name, a, b, c)  TRACE_EVENT(dtrace_instant, name, a, b, c)
+/* Record begin and end of span name */
+#define trace_begin(name)     TRACE_EVENT(dtrace_begin, name, 0, 0, 0)
+#define trace_end(name)       TRACE_EVENT(dtrace_end, name, 0, 0, 0)
+
+/** \brief Enable tracing
+ *
+ * Events are recorded into a preallocated ring buffer per thread, that keeps
+ * the most recent events. The buffers are written to \c file on exit and
+ * whenever \c SIGUSR1 is received. Use \c trace2json.py to convert them to
+ * the Chrome trace format.
+ */
+void trace_init(const char *file);
+
+/** \brief Register a trace site and return its id */
+unsigned int trace_register(const char *file, int line, const char *name);
+
+/** \brief Record an event of site \c id in the ring buffer of this thread */
+void trace_record(unsigned int id, dtrace_kind_t kind, int64_t a, int64_t b, int64_t c);
+
+/** \brief Write all ring buffers to the trace file
+ *
+ * Only async-signal-safe functions are used, so this may be called from a
+ * signal handler. Events recorded concurrently may be torn.
+ */
+void trace_dump(void);
+#endif /* DMENU_TRACE_H */
@@ -0,0 +1,55 @@
+#!/usr/bin/env python
+# Convert a binary trace written by `dmenu --trace FILE' to the Chrome trace
+# format, which can be loaded by chrome://tracing or Perfetto.
+
+import json, struct, sys
+
+MAGIC = b'dmenutrc'
+EVENT = struct.Struct('=QII3q')
+KINDS = {0: 'i', 1: 'B', 2: 'E'}
+
+def read(f, fmt):
+  s = struct.Struct(fmt)
+  data = f.read(s.size)
+  if len(data) < s.size: return None
+  return s.unpack(data)
+
+def read_string(f):
+  n, = read(f, '=I')
+  return f.read(n).decode('utf-8', 'replace')
+
+def trace_events(f):
+  if f.read(len(MAGIC)) != MAGIC: sys.exit('Not a dmenu trace')
+  version, n_sites = read(f, '=II')
+  if version != 1: sys.exit('Unsupported trace version %i' % version)
+
+  sites = {}
+  for site in range(1, n_sites + 1):
+    line, = read(f, '=I')
+    sites[site] = (read_string(f), line, read_string(f))
+
+  events = []
+  while True:
+    ring = read(f, '=II')
+    if not ring: break
+    tid, n_events = ring
+    for i in range(n_events):
+      time, site, kind, a, b, c = EVENT.unpack(f.read(EVENT.size))
+      events.append((time, tid, site, kind, (a, b, c)))
+
+  if not events: return []
+  start = min(e[0] for e in events)
+
+  out = []
+  for time, tid, site, kind, args in sorted(events):
+    file, line, name = sites.get(site, ('', 0, 'unknown'))
+    event = {'name': name, 'ph': KINDS.get(kind, 'i'), 'ts': (time - start) / 1000.0,
+             'pid': 1, 'tid': tid, 'args': {'site': '%s:%i' % (file, line), 'a': args[0], 'b': args[1], 'c': args[2]}}
+    if 'i' == event['ph']: event['s'] = 't'
+    out.append(event)
+  return out
+
+if __name__ == '__main__':
+  if len(sys.argv) != 2: sys.exit('usage: %s TRACE > trace.json' % sys.argv[0])
+  with open(sys.argv[1], 'rb') as f:
+    json.dump({'traceEvents': trace_events(f), 'displayTimeUnit': 'ns'}, sys.stdout)
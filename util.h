@@ -2,13 +2,20 @@
 #ifndef DMENU_UTIL_H
 #define DMENU_UTIL_H
 #include "clip.h"
+#include "trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 
-/* Debugging macros: debug(...), warn_if(...), assert(x) and assert2(x,...) */
+/* First argument of a macro, i.e. the format string of debug(...) */
+#define DEBUG_FORMAT(fmt, ...)  fmt
+
+/* Debugging macros: debug(...), warn_if(...), assert(x) and assert2(x,...).
+ * Every debug(...) is also a trace point named by its format string. Use
+ * trace(...) instead in hot loops. */
 #ifndef NDEBUG
 #define debug(...) \
   { \
+    trace(DEBUG_FORMAT(__VA_ARGS__, 0), 0, 0, 0); \
     fprintf(stderr, "%s:%i:Debug: ", __FILE__, __LINE__); \
     fprintf(stderr, __VA_ARGS__); \
     fputc('\n', stderr); \
@@ -16,8 +23,11 @@
   }
 #else
 
-/* Disable debug, i.e. make `debug(...)' a no-op */
-#define debug(...)
+/* Disable debug output, i.e. make `debug(...)' a trace point only */
+#define debug(...) \
+  { \
+    trace(DEBUG_FORMAT(__VA_ARGS__, 0), 0, 0, 0); \
+  }
 #endif /* NDEBUG */
 
 #define warning(...) \
@@ -1,6 +1,13 @@
+#include "stats.h"
 #include "util.h"
 #include "viewer.h"
 
+/* Advances of code points below this are cached in a table per font */
+#define VIEWER_ADVANCES 256
+
+/* Appended to truncated text, U+2026 */
+#define VIEWER_ELLIPSIS "\xe2\x80\xa6"
+
 const char *colors[dmenu_colorscheme_last][2] =
 {
 	/*                                    fg         bg       */
@@ -20,8 +27,19 @@ const char *fonts[] =
 	(char*)0
 };
 
+static int get_advance(const dfnt_t *font, const char *text, size_t n);
+static size_t fit_text(const dfnt_t *font, const char *text, size_t n, int max_width, int *width);
+static int get_textwidth_max(const dfnt_t *font, const char *text, size_t n, int max_width);
+static void draw_frame(dview_t *view, const xcmd_t *model);
 static void render_single_column_view(dview_t *view, int y, const xcmd_t *model);
 static void render_multiple_column_view(dview_t *view, int y, const xcmd_t *model);
+static void render_horizontal_view(dview_t *view, int x, int y, const xcmd_t *model);
+static void layout_validate(dview_t *view, const xcmd_t *model);
+static size_t layout_column_size(const dview_t *view);
+static int layout_column_width(dview_t *view, const xcmd_t *model, size_t column);
+static int layout_column_gap(const dview_t *view);
+static int layout_extend(dview_t *view, const xcmd_t *model, int max_width);
+static size_t layout_find_page(dview_t *view, const xcmd_t *model, size_t column, int max_width);
 
 /* Calculate width of bounding box around text */
 int get_textwidth(const dfnt_t *font, const char *text, size_t n)
@@ -30,67 +48,71 @@ int get_textwidth(const dfnt_t *font, const char *text, size_t n)
 
   if(!text || !n) return 0;
 
-  XGlyphInfo ext;
-	XftTextExtentsUtf8(font->x->display, font->xfont, (XftChar8 *)text, n, &ext);
-	debug("Width of text `%s' is %i.", text, ext.xOff);
+	return font->render->ops->text_width(font->render, font, text, n);
+}/*}}}*/
+
+/* Get advance of the single character of n bytes at text. Advances are
+ * measured once per font and code point. */
+int get_advance(const dfnt_t *font, const char *text, size_t n)
+{/*{{{*/
+  assert(font);
+  assert(font->advances);
+
+  const gunichar c = g_utf8_get_char(text);
 
-	return ext.xOff;
+  if(VIEWER_ADVANCES > c) {
+    if(0 > font->advances[c]) font->advances[c] = get_textwidth(font, text, n);
+    return font->advances[c];
+  } /* if ... */
+
+  const gpointer key = GUINT_TO_POINTER(c);
+  int advance = GPOINTER_TO_INT(g_hash_table_lookup(font->wide_advances, key)) - 1;
+
+  if(0 > advance) {
+    advance = get_textwidth(font, text, n);
+    g_hash_table_insert(font->wide_advances, key, GINT_TO_POINTER(advance + 1));
+  } /* if ... */
+
+  return advance;
 }/*}}}*/
 
-dfnt_t *load_xfont(const dx11_t *x, const char *fontname, FcPattern *fontpattern)
+/* Find the longest prefix of text, that fits into max_width. Returns its
+ * length in bytes and stores its width in width. Only the characters up to
+ * the first one exceeding max_width are measured. */
+size_t fit_text(const dfnt_t *font, const char *text, size_t n, int max_width, int *width)
 {/*{{{*/
-  assert(x);
+  assert(font);
+  assert(width);
 
-	dfnt_t *font;
-	XftFont *xfont = NULL;
-	FcPattern *pattern = NULL;
-
-	if (fontname) {
-		/* Using the pattern found at font->xfont->pattern does not yield the
-		 * same substitution results as using the pattern returned by
-		 * FcNameParse; using the latter results in the desired fallback
-		 * behaviour whereas the former just results in missing-character
-		 * rectangles being drawn, at least with some fonts. */
-		debug("Load font from name: `%s'.", fontname);
-
-		xfont = XftFontOpenName(x->display, x->screen, fontname);
-		warn_if(!xfont, "Cannot load font from name: `%s'", fontname);
-
-		if(!xfont) return NULL;
-
-    pattern = FcNameParse((FcChar8*)fontname);
-    warn_if(!pattern, "Cannot parse font name to pattern: `%s'", fontname);
-    
-    if(!pattern) {
-      XftFontClose(x->display, xfont);
-      return NULL;
-    } /* if ... */
+  const char *it = text;
+  const char *const end = text + n;
+  int w = 0;
 
-	} else if (fontpattern) {
-	  debug("Load font from pattern.");
+  while(it < end) {
+    const char *next = g_utf8_next_char(it);
+    const int advance = get_advance(font, it, next - it);
 
-	  xfont = XftFontOpenPattern(x->display, fontpattern);
-	  warn_if(!xfont, "Cannot load font from pattern.");
+    if(max_width < w + advance) break;
 
-	  if(!xfont) return NULL;
+    w += advance;
+    it = next;
+  } /* while ... */
 
-	} else {
-		die("No font specified.");
-	} /* if ... */
+  *width = w;
+  return it - text;
+}/*}}}*/
 
-  /* Allocate memory and initialize font font */
-	font = xmalloc(sizeof(dfnt_t));
-	font->x = x;
-	font->xfont = xfont;
-	font->pattern = pattern;
-	font->height = xfont->ascent + xfont->descent;
-	font->padding = font->height / 2;
-	font->next = NULL;
+/* Calculate width of text like get_textwidth(), but stop measuring text wider
+ * than max_width and return max_width instead. */
+int get_textwidth_max(const dfnt_t *font, const char *text, size_t n, int max_width)
+{/*{{{*/
+  int width = 0;
+  const size_t fit = fit_text(font, text, n, max_width, &width);
 
-	return font;
+  return (fit < n) ? max_width : width;
 }/*}}}*/
 
-void init_viewer_style(dstyle_t *style, const dview_t *view, const char *colornames[], size_t n, dfnt_t *font)
+void init_viewer_style(dstyle_t *style, dview_t *view, const char *colornames[], size_t n, dfnt_t *font)
 {/*{{{*/
   assert(style);
   assert(view);
@@ -105,8 +127,40 @@ void init_viewer_style(dstyle_t *style, const dview_t *view, const char *colorna
   warn_if(!font, "Style is created without a corresponding font.");
 
   /* Allocate colors */
-  assert2(XftColorAllocName(view->x->display, view->visual, view->colormap, colornames[0], &style->foreground), "Cannot allocate color: `%s'", colornames[0]);
-  assert2(XftColorAllocName(view->x->display, view->visual, view->colormap, colornames[1], &style->background), "Cannot allocate color: `%s'", colornames[1]);
+  drender_t *render = &view->render;
+  assert2(render->ops->alloc_color(render, colornames[0], &style->foreground), "Cannot allocate color: `%s'", colornames[0]);
+  assert2(render->ops->alloc_color(render, colornames[1], &style->background), "Cannot allocate color: `%s'", colornames[1]);
+}/*}}}*/
+
+/* Calculate width of prompt and input */
+void setup_viewer_text(dview_t *view)
+{/*{{{*/
+  assert(view);
+
+  /* Calculate text width of prompt */
+  if(view->prompt.text) {
+    const dfnt_t *font = view->prompt.style.font;
+    const glong len = g_utf8_strlen(view->prompt.text, -1);  /* nul-terminated string */
+    assert(0 <= len);
+
+    view->prompt.size = (size_t)len;
+    view->prompt.width = get_textwidth(font, view->prompt.text, view->prompt.size);
+    debug("Configure prompt: text=`%s', width=%i, padding=%i", view->prompt.text, view->prompt.width, font->padding);
+
+    view->prompt.width += font->padding;
+  } else {
+    view->prompt.size = 0;
+    view->prompt.width = 0;
+
+  } /* if ... */
+
+  /* Calculate width of input. Without lines, the items are placed next to
+   * the input field. */
+  if(view->menu.lines) {
+    view->input.width = view->menu.width - view->prompt.width;
+  } else {
+    view->input.width = view->menu.width / 3;
+  } /* if ... */
 }/*}}}*/
 
 void setup_viewer(dview_t *view)
@@ -229,25 +283,7 @@ void setup_viewer(dview_t *view)
 		view->menu.width = view->x->width;
 	} /* if ... */
 
-  /* Calculate text width of prompt */
-  if(view->prompt.text) {
-    const dfnt_t *font = view->prompt.style.font;
-    const glong len = g_utf8_strlen(view->prompt.text, -1);  /* nul-terminated string */
-    assert(0 <= len);
-
-    view->prompt.size = (size_t)len;
-    view->prompt.width = get_textwidth(font, view->prompt.text, view->prompt.size);
-    debug("Configure prompt: text=`%s', width=%i, padding=%i", view->prompt.text, view->prompt.width, font->padding);
-
-    view->prompt.width += font->padding;
-  } else {
-    view->prompt.size = 0;
-    view->prompt.width = 0;
-
-  } /* if ... */
-
-  /* Calculate width of input */
-  view->input.width = view->menu.width - view->prompt.width;
+  setup_viewer_text(view);
 
 	/* Create menu window */
 	XSetWindowAttributes menu_attrs;
@@ -264,22 +300,23 @@ void setup_viewer(dview_t *view)
 	    view->x->depth, CopyFromParent, view->visual,
 	    CWOverrideRedirect | CWBackPixel | CWEventMask, &menu_attrs);
 
-	XMapRaised(view->x->display, view->menu_hwnd);
+  /* Render into shared memory image, if possible */
+  if(view->use_shm) {
+    drender_t shm;
+
+    if(render_shm_init(&shm, &view->render, view->x, view->visual, view->menu.x, view->menu.y, view->menu.width, view->menu.height)) {
+      warning("Cannot use MIT-SHM, fall back to drawing through the protocol.");
+    } else {
+      view->render = shm;
+    } /* if ... */
+  } /* if ... */
 }/*}}}*/
 
-void viewer_init(dview_t *view, const dx11_t *x, const char *colornames[][2], const char *fontnames[])
+/* Load fonts, create styles and the layout cache using the current render
+ * backend */
+void init_viewer_resources(dview_t *view, const char *colornames[][2], const char *fontnames[])
 {/*{{{*/
-  assert(x);
   assert(view);
-  debug("Initialize user interface (viewer).");
-
-  view->x = x;
-  view->pixmap = XCreatePixmap(x->display, x->root, x->width, x->height, x->depth);
-  view->gc = XCreateGC(x->display, x->root, 0, NULL);
-  XSetLineAttributes(x->display, view->gc, 1, LineSolid, CapButt, JoinMiter);
-
-  view->visual = DefaultVisual(view->x->display, view->x->screen);
-  view->colormap = DefaultColormap(view->x->display, view->x->screen);
 
   /* Initialize fonts */
   assert2(fontnames && fontnames[0], "No fonts to load");
@@ -288,13 +325,18 @@ void viewer_init(dview_t *view, const dx11_t *x, const char *colornames[][2], co
   const char **it = fontnames;
 
   while(*it) {
-    dfnt_t *new_font = load_xfont(view->x, *it, NULL);
+    dfnt_t *new_font = view->render.ops->load_font(&view->render, *it);
     warn_if(!new_font, "Cannot load font: %s", *it);
     it += 1;
 
     /* Ignore invalid fonts */
     if(!new_font) continue;
 
+    /* Advances are cached on first use */
+    new_font->advances = (int*)xmalloc(VIEWER_ADVANCES * sizeof(int));
+    memset(new_font->advances, 0xff, VIEWER_ADVANCES * sizeof(int));
+    new_font->wide_advances = g_hash_table_new(g_direct_hash, g_direct_equal);
+
     view->fonts = g_list_prepend(view->fonts, new_font);
   } /* while ... */
 
@@ -313,22 +355,94 @@ void viewer_init(dview_t *view, const dx11_t *x, const char *colornames[][2], co
 	init_viewer_style(&view->input.style_good, view, colornames[dmenu_colorscheme_input_good], 2, font);
 	init_viewer_style(&view->input.style_bad, view, colornames[dmenu_colorscheme_input_bad], 2, font);
 
+  /* Column layout is computed on demand */
+  view->layout.generation = 0;
+  view->layout.model = NULL;
+  view->layout.valid = 0;
+  view->layout.widths = g_array_new(FALSE, FALSE, sizeof(int));
+  view->layout.pages = g_array_new(FALSE, FALSE, sizeof(size_t));
+}/*}}}*/
+
+void viewer_init(dview_t *view, const dx11_t *x, const char *colornames[][2], const char *fontnames[])
+{/*{{{*/
+  assert(x);
+  assert(view);
+  debug("Initialize user interface (viewer).");
+
+  view->x = x;
+  view->visual = DefaultVisual(view->x->display, view->x->screen);
+  view->colormap = DefaultColormap(view->x->display, view->x->screen);
+  render_x11_init(&view->render, x, view->visual, view->colormap);
+
+  init_viewer_resources(view, colornames, fontnames);
+
   /* Create windows */
   setup_viewer(view);
 }/*}}}*/
 
-void draw_rect(dview_t *view, const XftColor color, int x, int y, int width, int height, int filled)
+void viewer_init_offscreen(dview_t *view, int width, int height, const char *colornames[][2], const char *fontnames[])
+{/*{{{*/
+  assert(view);
+  debug("Initialize offscreen user interface (viewer).");
+
+  view->x = NULL;
+  view->menu_hwnd = None;
+  view->visual = NULL;
+  view->colormap = None;
+  render_offscreen_init(&view->render, width, height);
+
+  init_viewer_resources(view, colornames, fontnames);
+
+	/* Calculate menu geometry */
+	view->menu.line_height = view->menu.style_normal_even.font->height + 2;
+	view->menu.lines = max(0, view->menu.lines);
+	view->menu.height = min(height, (1 + view->menu.lines) * view->menu.line_height);
+	view->menu.x = 0;
+	view->menu.y = 0;
+	view->menu.width = width;
+
+  setup_viewer_text(view);
+}/*}}}*/
+
+void viewer_show(dview_t *view)
+{/*{{{*/
+  assert(view);
+  debug("Show menu window.");
+
+	XMapRaised(view->x->display, view->menu_hwnd);
+}/*}}}*/
+
+void viewer_hide(dview_t *view)
+{/*{{{*/
+  assert(view);
+  debug("Hide menu window.");
+
+	XUnmapWindow(view->x->display, view->menu_hwnd);
+	XSync(view->x->display, False);
+}/*}}}*/
+
+void viewer_set_prompt(dview_t *view, char *text)
 {/*{{{*/
   assert(view);
-  debug("Draw rectangle: x=%i, y=%i, width=%i, height=%i, filled=%s", x, y, width, height, filled ? "yes" : "no");
+  debug("Set prompt: `%s'", text ? text : "");
+
+  view->prompt.text = text;
+  setup_viewer_text(view);
 
-	XSetForeground(view->x->display, view->gc, color.pixel);
+  /* The horizontal view depends on the width of the prompt */
+  view->layout.valid = 0;
+}/*}}}*/
+
+void draw_rect(dview_t *view, const XftColor color, int x, int y, int width, int height, int filled)
+{/*{{{*/
+  assert(view);
+  trace("draw_rect", x, y, width);
 
   assert(filled ? 1 < width : 0 < width);
   assert(filled ? 1 < height : 0 < height);
 
-	if (filled) { XFillRectangle(view->x->display, view->pixmap, view->gc, x, y, width, height); 
-	} else { XDrawRectangle(view->x->display, view->pixmap, view->gc, x, y, width - 1, height - 1); 
+	if (filled) { view->render.ops->fill_rect(&view->render, &color, x, y, width, height);
+	} else { view->render.ops->draw_rect(&view->render, &color, x, y, width, height);
 	} /* if ... */
 }/*}}}*/
 
@@ -338,10 +452,11 @@ void draw_ntext(dview_t *view, const dstyle_t *style, int x, int y, int width, i
   assert(style);
   assert(0 < width);
   assert(0 < height);
-  debug("Draw text: x=%i, y=%i, width=%i, height=%i, text=`%s'", x, y, width, height, text);
+  trace("draw_text", x, y, n);
 
   /* Render box behind text */
-  draw_rect(view, style->background, x, y, width, height, 1);
+  if(dmenu_pass_boxes == view->pass) draw_rect(view, style->background, x, y, width, height, 1);
+  if(dmenu_pass_texts != view->pass) return;
 
   /* Check, if there's enough space for the text box */
   x += style->font->padding / 2;
@@ -350,14 +465,25 @@ void draw_ntext(dview_t *view, const dstyle_t *style, int x, int y, int width, i
 
   if(0 >= width) return;
 
-  /* Create rendering context and start rendering the text */
-  XftDraw *draw = XftDrawCreate(view->x->display, view->pixmap, view->visual, view->colormap);
+  /* Only the prefix fitting into the box is passed on, so the cost doesn't
+   * depend on the length of text. Truncated text ends in an ellipsis. */
+  const dfnt_t *font = style->font;
+  int text_width = 0;
+  int ellipsis_width = 0;
+  size_t fit = fit_text(font, text, n, width, &text_width);
+
+  if(fit < n) {
+    ellipsis_width = get_advance(font, VIEWER_ELLIPSIS, strlen(VIEWER_ELLIPSIS));
+    fit = fit_text(font, text, fit, width - ellipsis_width, &text_width);
+  } /* if ... */
 
   /* Center text vertically in bounding box */
-	const int text_y = y + (height - style->font->height) / 2 + style->font->xfont->ascent;
-	XftDrawString8(draw, &style->foreground, style->font->xfont, x, text_y, (XftChar8*)text, n);
+	const int text_y = y + (height - font->height) / 2 + font->ascent;
+	if(fit) view->render.ops->draw_text(&view->render, font, &style->foreground, x, text_y, text, fit);
 
-	XftDrawDestroy(draw);
+	if(ellipsis_width && (ellipsis_width <= width)) {
+	  view->render.ops->draw_text(&view->render, font, &style->foreground, x + text_width, text_y, VIEWER_ELLIPSIS, strlen(VIEWER_ELLIPSIS));
+	} /* if ... */
 }/*}}}*/
 
 /* Draw text on ui using style at x/y. The bounding box is fixed to width and
@@ -367,11 +493,41 @@ void draw_text(dview_t *view, const dstyle_t *style, int x, int y, int width, in
   draw_ntext(view, style, x, y, width, height, text, strlen(text));
 }/*}}}*/
 
+/* Draw the display field of item, like draw_text(). */
+void draw_item(dview_t *view, const dstyle_t *style, int x, int y, int width, int height, const xcmd_t *model, const char *item)
+{/*{{{*/
+  size_t n = 0;
+  const char *text = xcmd_item_field(model, item, xcmd_field_display, &n);
+  draw_ntext(view, style, x, y, width, height, text, n);
+}/*}}}*/
+
 void viewer_update(dview_t *view, const xcmd_t *model)
 {/*{{{*/
   assert(view);
   assert(model);
   debug("Update user interface.");
+  trace_begin("viewer_update");
+
+  const gint64 begin = stats_now();
+
+  /* All boxes are drawn before any text */
+  for(view->pass = 0; view->pass < dmenu_pass_last; view->pass += 1) {
+    draw_frame(view, model);
+  } /* for ... */
+
+  /* Presenting includes flushing and syncing X */
+  const gint64 rendered = stats_record(dstats_render, begin);
+	view->render.ops->present(&view->render, view->menu_hwnd, view->menu.x, view->menu.y, view->menu.width, view->menu.height);
+	stats_presented(stats_record(dstats_present, rendered));
+  trace_end("viewer_update");
+
+}/*}}}*/
+
+/* Draw a single pass of the frame */
+void draw_frame(dview_t *view, const xcmd_t *model)
+{/*{{{*/
+  assert(view);
+  assert(model);
 
 	//unsigned int curpos;
 	//struct item *item;
@@ -381,7 +537,9 @@ void viewer_update(dview_t *view, const xcmd_t *model)
 	int max_item_width = view->menu.width;
 
 	/* Menu background */
-	draw_rect(view, view->menu.style_normal_even.background, view->menu.x, view->menu.y, view->menu.width, view->menu.height, 1);
+	if(dmenu_pass_boxes == view->pass) {
+	  draw_rect(view, view->menu.style_normal_even.background, view->menu.x, view->menu.y, view->menu.width, view->menu.height, 1);
+	} /* if ... */
 
 	if(view->prompt.text) {
 	  debug("Draw prompt to user interface: x=%i, y=%i, width=%i, height=%i", x, y, view->prompt.width, view->menu.line_height);
@@ -401,11 +559,12 @@ void viewer_update(dview_t *view, const xcmd_t *model)
       draw_text(view, &view->input.style_bad, x, y,  view->input.width, view->menu.line_height, model->matches.input);
     } /* if ... */
   } /* if ... */
-  y += view->menu.line_height;
 
 
   /* Render menu items */
 	if(0 < view->menu.lines) { 
+	  y += view->menu.line_height;
+
 	  if(view->single_column || (model->matches.count <= view->menu.lines)) {
 	    render_single_column_view(view, y, model);
 	  } else {
@@ -414,12 +573,10 @@ void viewer_update(dview_t *view, const xcmd_t *model)
   	  render_multiple_column_view(view, y, model);
   	} /* if ... */
 
-	} else { die("No such method implemented");
+	} else {
+	  /* Render items in the same line right next to the input */
+	  render_horizontal_view(view, x + view->input.width, y, model);
   } /* if ... */
-
-	XCopyArea(view->x->display, view->pixmap, view->menu_hwnd, view->gc, view->menu.x, view->menu.y, view->menu.width, view->menu.height, 0, 0);
-	XSync(view->x->display, False);
-
 }/*}}}*/
 
 void render_single_column_view(dview_t *view, int y, const xcmd_t *model)
@@ -440,10 +597,10 @@ void render_single_column_view(dview_t *view, int y, const xcmd_t *model)
     /* Redering full text */
     if(model->matches.selected == i) {
       /* Render selected text */
-      draw_text(view, slct_style, x, y, view->menu.width, view->menu.line_height, item);
+      draw_item(view, slct_style, x, y, view->menu.width, view->menu.line_height, model, item);
     } else {
       /* Render text with alternating style */
-      draw_text(view, item_style, x, y, view->menu.width, view->menu.line_height, item);
+      draw_item(view, item_style, x, y, view->menu.width, view->menu.line_height, model, item);
     } /* if ... */
   
     y += view->menu.line_height;
@@ -451,6 +608,133 @@ void render_single_column_view(dview_t *view, int y, const xcmd_t *model)
   } /* for ... */
 }/*}}}*/
 
+/* Drop cached column layout, if it doesn't belong to the current match-set */
+void layout_validate(dview_t *view, const xcmd_t *model)
+{/*{{{*/
+  assert(view);
+  assert(model);
+
+  const int same_model = (view->layout.model == model);
+  if(view->layout.valid && same_model && (view->layout.generation == model->matches.generation)) return;
+  debug("Reset column layout for match-set generation %lu.", model->matches.generation);
+
+  const size_t first_column = 0;
+  view->layout.widths = g_array_set_size(view->layout.widths, 0);
+  view->layout.pages = g_array_set_size(view->layout.pages, 0);
+  view->layout.pages = g_array_append_val(view->layout.pages, first_column);
+  view->layout.generation = model->matches.generation;
+  view->layout.model = model;
+  view->layout.valid = 1;
+}/*}}}*/
+
+/* Number of items per column. The horizontal view (no lines) uses a column
+ * per item. */
+size_t layout_column_size(const dview_t *view)
+{/*{{{*/
+  assert(view);
+  return view->menu.lines ? view->menu.lines : 1;
+}/*}}}*/
+
+/* Get width of column. Columns are measured in order and only once. */
+int layout_column_width(dview_t *view, const xcmd_t *model, size_t column)
+{/*{{{*/
+  assert(view);
+  assert(model);
+
+  const dfnt_t *font = view->menu.style_select.font;
+  const size_t column_size = layout_column_size(view);
+
+  /* Items wider than the menu are truncated, so they aren't measured further */
+  const int max_width = max(view->menu.width - font->padding, 0);
+
+  while(view->layout.widths->len <= column) {
+    const size_t lo = view->layout.widths->len * column_size;
+    const size_t hi = min(lo + column_size, model->matches.count);
+    int width = 0;
+    size_t i;
+
+    for(i = lo; i < hi; i += 1) {
+      size_t n = 0;
+      const char *text = xcmd_item_field(model, model->matches.index[i], xcmd_field_display, &n);
+      const int w = get_textwidth_max(font, text, n, max_width);
+      width = max(width, w);
+    } /* for ... */
+
+    width += font->padding;
+    view->layout.widths = g_array_append_val(view->layout.widths, width);
+  } /* while ... */
+
+  return g_array_index(view->layout.widths, int, column);
+}/*}}}*/
+
+/* Gap between two columns. Items of the horizontal view are adjacent. */
+int layout_column_gap(const dview_t *view)
+{/*{{{*/
+  assert(view);
+  return view->menu.lines ? view->menu.style_select.font->padding : 0;
+}/*}}}*/
+
+/* Lay out the page following the last known page, such that it fits into
+ * max_width. Returns zero, if there're no more columns left. */
+int layout_extend(dview_t *view, const xcmd_t *model, int max_width)
+{/*{{{*/
+  assert(view);
+  assert(model);
+
+  const int gap = layout_column_gap(view);
+  const size_t column_size = layout_column_size(view);
+  const size_t n_columns = (model->matches.count + column_size - 1) / column_size;
+  const size_t first = g_array_index(view->layout.pages, size_t, view->layout.pages->len - 1);
+  size_t column = first;
+  int total_width = 0;
+
+  if(n_columns <= first) return 0;
+
+  /* Every page contains at least a single column */
+  while(column < n_columns) {
+    const int w = layout_column_width(view, model, column);
+    if((first != column) && (max_width < total_width + w)) break;
+
+    total_width += w + gap;
+    column += 1;
+  } /* while ... */
+
+  debug("Lay out page %u: columns=[%lu, %lu)", view->layout.pages->len - 1, first, column);
+  view->layout.pages = g_array_append_val(view->layout.pages, column);
+
+  return 1;
+}/*}}}*/
+
+/* Find page containing column. The cached layout is extended as required, so
+ * that only pages up to the requested one are ever measured. */
+size_t layout_find_page(dview_t *view, const xcmd_t *model, size_t column, int max_width)
+{/*{{{*/
+  assert(view);
+  assert(model);
+
+  layout_validate(view, model);
+
+  while(g_array_index(view->layout.pages, size_t, view->layout.pages->len - 1) <= column) {
+    if(!layout_extend(view, model, max_width)) break;
+  } /* while ... */
+
+  /* Binary search on first column of each page */
+  size_t page_lo = 0;
+  size_t page_hi = view->layout.pages->len - 1;
+
+  while(1 < page_hi - page_lo) {
+    const size_t page = (page_lo + page_hi) / 2;
+
+    if(column < g_array_index(view->layout.pages, size_t, page)) {
+      page_hi = page;
+    } else {
+      page_lo = page;
+    } /* if ... */
+  } /* while ... */
+
+  return page_lo;
+}/*}}}*/
+
 void render_multiple_column_view(dview_t *view, int y, const xcmd_t *model)
 {/*{{{*/
   const dstyle_t *style[3] = 
@@ -460,43 +744,64 @@ void render_multiple_column_view(dview_t *view, int y, const xcmd_t *model)
     &view->menu.style_select
   };/*}}}*/
 
-  const int padding = style[2]->font->padding;
-  int total_width = view->menu.width;
+  const int gap = layout_column_gap(view);
   int x = view->menu.x;
 
-  /* Identify block, where the selected item is placed in */
-  const size_t block = model->matches.selected / view->menu.lines;
-  size_t i = block * view->menu.lines;
-
-  /* Render currently visible items, until the screen is filled */
-  while(0 < total_width) {
-    const int column_lo = i;
-    const int column_hi = min(i + view->menu.lines, model->matches.count);
-    int max_item_width = 0;
-  
-    /* Calculate width of current column */
-    for(; i < column_hi; i += 1) {
-      const char *text = model->matches.index[i];
-      const size_t n = strlen(text);
-      const int w = get_textwidth(style[2]->font, text, n);
-      max_item_width = padding + max(max_item_width, w);
-    }/* for ... */
-  
-    /* Check if there's eneough space for the current column */
-    total_width -= max_item_width;
-    if(0 > total_width) break;
-  
-    /* Actually render current column */
-    for(i = column_lo; i < column_hi; i += 1) {
-      const int id = (model->matches.selected != i) ? (column_lo - i) % 2 : 2;
-      const int yy = y + (i - column_lo) * view->menu.line_height;
-      const char *text = model->matches.index[i];
-  
-      draw_text(view, style[id], x, yy, max_item_width, view->menu.line_height, text);
+  /* Identify page, where the selected item is placed on */
+  const size_t selected_column = model->matches.selected / view->menu.lines;
+  const size_t page = layout_find_page(view, model, selected_column, view->menu.width);
+  const size_t column_lo = g_array_index(view->layout.pages, size_t, page);
+  const size_t column_hi = g_array_index(view->layout.pages, size_t, page + 1);
+  size_t column;
+
+  /* Render currently visible columns */
+  for(column = column_lo; column < column_hi; column += 1) {
+    const int width = g_array_index(view->layout.widths, int, column);
+    const size_t lo = column * view->menu.lines;
+    const size_t hi = min(lo + view->menu.lines, model->matches.count);
+    size_t i;
+
+    for(i = lo; i < hi; i += 1) {
+      const int id = (model->matches.selected != i) ? (i - lo) % 2 : 2;
+      const int yy = y + (i - lo) * view->menu.line_height;
+      const char *item = model->matches.index[i];
+
+      draw_item(view, style[id], x, yy, width, view->menu.line_height, model, item);
     } /* for ... */
-  
-    x += max_item_width + padding;
-    if(column_lo == column_hi) break;
-    i = column_hi;
-  } /* while ... */
+
+    x += width + gap;
+  } /* for ... */
+}/*}}}*/
+
+void render_horizontal_view(dview_t *view, int x, int y, const xcmd_t *model)
+{/*{{{*/
+  const dstyle_t *item_style = &view->menu.style_normal_even;
+  const dstyle_t *slct_style = &view->menu.style_select;
+  const dfnt_t *font = slct_style->font;
+
+  /* Reserve space for page indicators on both sides of the items */
+  const int arrow_width = get_textwidth(font, "<", 1) + font->padding;
+  const int x_hi = view->menu.x + view->menu.width;
+  const int max_width = x_hi - x - 2 * arrow_width;
+
+  if(!model->matches.count || (0 >= max_width)) return;
+
+  /* Only items of the visible page are measured */
+  const size_t page = layout_find_page(view, model, model->matches.selected, max_width);
+  const size_t idx_lo = g_array_index(view->layout.pages, size_t, page);
+  const size_t idx_hi = g_array_index(view->layout.pages, size_t, page + 1);
+  size_t i;
+
+  if(0 < page) draw_text(view, item_style, x, y, arrow_width, view->menu.line_height, "<");
+  x += arrow_width;
+
+  for(i = idx_lo; i < idx_hi; i += 1) {
+    const int width = min(g_array_index(view->layout.widths, int, i), max_width);
+    const dstyle_t *style = (model->matches.selected == i) ? slct_style : item_style;
+
+    draw_item(view, style, x, y, width, view->menu.line_height, model, model->matches.index[i]);
+    x += width;
+  } /* for ... */
+
+  if(idx_hi < model->matches.count) draw_text(view, item_style, x_hi - arrow_width, y, arrow_width, view->menu.line_height, ">");
 }/*}}}*/
@@ -1,10 +1,10 @@
 #ifndef DMENU_VIEWER_H
 #define DMENU_VIEWER_H
+#include "render.h"
 #include "x.h"
 #include "xcmd.h"
 
 typedef struct dmenu_viewer dview_t;
-typedef struct dmenu_font dfnt_t;
 typedef struct dmenu_style dstyle_t;
 
 enum demenu_colorscheme
@@ -18,6 +18,15 @@ enum demenu_colorscheme
   dmenu_colorscheme_last
 };/*}}}*/
 
+/* Frames are drawn in two passes: first the boxes behind all texts, then the
+ * texts. So backends may batch the boxes, which never overlap any text. */
+enum dmenu_pass
+{/*{{{*/
+  dmenu_pass_boxes,
+  dmenu_pass_texts,
+  dmenu_pass_last
+};/*}}}*/
+
 struct dmenu_style
 {/*{{{*/
   dfnt_t *font;
@@ -25,24 +34,12 @@ struct dmenu_style
   XftColor background;
 };/*}}}*/
 
-struct dmenu_font
-{/*{{{*/
-	const dx11_t *x;
-	int height;
-	int padding;
-	XftFont *xfont;
-	FcPattern *pattern;
-	struct dmenu_font *next;
-	struct dmenu_font *prev;
-};/*}}}*/
-
 struct dmenu_viewer
 {/*{{{*/
-  const dx11_t *x;  /* Handle to X window system */
+  const dx11_t *x;  /* Handle to X window system, NULL if offscreen */
+  drender_t render; /* Drawing primitives */
 
   Window menu_hwnd;
-  Pixmap pixmap;
-  GC gc;
   Atom clip;
   Atom utf8;
   Visual *visual;
@@ -77,14 +74,36 @@ struct dmenu_viewer
     dstyle_t style_select;
   } menu;
 
+  /* Column layout of the multiple column and the horizontal view. Column i
+   * contains the items [i * lines, (i + 1) * lines) of the match-set, or just
+   * item i without lines. The layout is computed lazily and kept until the
+   * match-set generation changes. */
+  struct
+  {
+    size_t generation;  /* Match-set generation of the cached layout */
+    const xcmd_t *model;  /* Model of the cached layout */
+    int valid;
+    GArray *widths; /* Width of all columns measured so far */
+    GArray *pages;  /* First column of each page; last entry is end of last page */
+  } layout;
+
   int show_at_bottom;
   int single_column;
+  int use_shm;  /* Rasterize client-side into a shared memory image */
+  int pass; /* Pass of the frame currently drawn */
 };/*}}}*/
 
 extern const char *colors[dmenu_colorscheme_last][2];
 extern const char *fonts[];
 
 void viewer_init(dview_t *view, const dx11_t *x, const char *colornames[][2], const char *fontnames[]);
+/* Initialize viewer without display, rendering into a width x height buffer */
+void viewer_init_offscreen(dview_t *view, int width, int height, const char *colornames[][2], const char *fontnames[]);
 void viewer_update(dview_t *view, const xcmd_t *model);
+/* Map or unmap the menu window. The window is created unmapped. */
+void viewer_show(dview_t *view);
+void viewer_hide(dview_t *view);
+/* Replace prompt by text, which must remain valid. NULL disables the prompt. */
+void viewer_set_prompt(dview_t *view, char *text);
 
 #endif /* DMENU_VIEWER_H */
@@ -1,13 +1,148 @@
+#include "bitmap.h"
 #include "clip.h"
+#include "stats.h"
 #include "xcmd.h"
 #include "util.h"
 #include <ctype.h>
+#include <gio/gio.h>
 #include <glib.h>
+#include <limits.h>
+#include <locale.h>
 #include <regex.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef ZSTD
+#include <zstd.h>
+#endif /* ZSTD */
 
 static void *match_regex_initx(xcmd_t *ptr, const char *input, const int flags);
+static void *match_gregex_initx(xcmd_t *ptr, const char *input, const GRegexCompileFlags flags);
+static int xcmd_parse_fields(const char *spec, unsigned int *first, unsigned int *last);
+static void xcmd_find_fields(const xcmd_t *ptr, const char *item, size_t n, xspan_t *spans);
+static xchunk_t *xcmd_reserve_item(xcmd_t *ptr, size_t n);
+static xchunk_t *xcmd_grow_item(xcmd_t *ptr, xchunk_t *chunk, size_t n, size_t required);
+static void xcmd_append_text(xcmd_t *ptr, xchunk_t **chunk, size_t *n, const char *text, size_t length);
+static int xcmd_read_compressed(xcmd_t *ptr, xchunk_t **chunk, size_t *n, FILE *f, const guint8 *magic, size_t m, int format);
+static void xcmd_commit_item(xcmd_t *ptr, xchunk_t *chunk, size_t n);
+static void xcmd_merge_items(xcmd_t *ptr, xcmd_t *segment);
+static guint xcmd_hash_item(gconstpointer item);
+static gboolean xcmd_equal_items(gconstpointer a, gconstpointer b);
+static void xcmd_sort_items(xcmd_t *ptr);
+static void *match_tokens_initx(xcmd_t *ptr, const char *input, const int icase);
+static void xcmd_match_items(xcmd_t *ptr, char *const *items, size_t n, guint8 *ranks);
+static void xcmd_add_match(xcmd_t *ptr, char **matches, guint32 position, int rank, size_t *ranked);
+static void xcmd_scan_items(xcmd_t *ptr, char **matches, size_t count, size_t budget, size_t *ranked);
+static void xcmd_scan_candidates(xcmd_t *ptr, const dbitmap_t *candidates, size_t *ranked);
+static void xcmd_rank_matches(xcmd_t *ptr, const size_t *ranked);
+static void xcmd_stop_matching(xcmd_t *ptr);
+static void xcmd_cache_touch(xcmd_t *ptr, xcentry_t *entry);
+static xcentry_t *xcmd_cache_lookup(xcmd_t *ptr, const char *input);
+static xcentry_t *xcmd_cache_lookup_prefix(xcmd_t *ptr, const char *input);
+static void xcmd_cache_restore(xcmd_t *ptr, const xcentry_t *entry, size_t *ranked);
+static void xcmd_cache_insert(xcmd_t *ptr);
+static void xcmd_cache_evict(xcmd_t *ptr, size_t capacity);
+
+/* Header preceding every item in items.chunks */
+typedef struct
+{
+  guint32 id;
+  guint32 length;
+} xheader_t;
+
+/* Chunk of the item arena, holding headers and items */
+struct xcmd_chunk
+{
+  xchunk_t *next;
+  /* Number of bytes allocated for data */
+  size_t size;
+  /* Number of bytes used in data */
+  size_t used;
+  char data[];
+};
+
+/* Chunks double in size from chunk_min up to chunk_max */
+static const size_t chunk_min = 64 * 1024;
+static const size_t chunk_max = 16 * 1024 * 1024;
+/* Space reserved for reading a line, before a new chunk is started */
+static const size_t line_min = 4096;
+
+/* Job sorting a run of the item index or merging two adjacent runs */
+typedef struct
+{
+  const xcmd_t *model;
+  /* Collation keys by item id, only used for xcmd_sort_locale */
+  char **keys;
+  char **items;
+  /* Destination of merging */
+  char **buffer;
+  /* Length of the first and the second run, the latter is only merged */
+  size_t n;
+  size_t m;
+  int merge;
+} xsortjob_t;
+
+/* Stream read on a thread of its own into a segment of items */
+typedef struct
+{
+  xcmd_t segment;
+  FILE *f;
+  GThread *thread;
+  int status;
+} xreadjob_t;
+
+/* Compression formats detected by their magic bytes */
+enum { XCMD_PLAIN, XCMD_GZIP, XCMD_ZSTD };
+
+/* Block of decompressed text, passed from the decompressing thread to the
+ * reading one */
+typedef struct
+{
+  size_t length;
+  char data[];
+} xblock_t;
+
+/* Stream decompressed on a thread of its own, while the text is indexed */
+typedef struct
+{
+  FILE *f;
+  int format;
+  /* Bytes already read to detect the format */
+  guint8 magic[4];
+  size_t m;
+  /* Blocks to be indexed, an empty one ends the stream */
+  GAsyncQueue *full;
+  /* Blocks to be filled */
+  GAsyncQueue *free;
+  int status;
+} xinflatejob_t;
+
+/* Decompressed text is passed in this many blocks of this size, so memory is
+ * bounded by them, whatever the size of the stream */
+#define XCMD_INFLATE_BLOCKS 4
+static const size_t inflate_block = 256 * 1024;
+
+/* Items are only sorted in parallel, if every run has this many items */
+static const size_t sort_run_min = 4096;
+
+/* Number of items passed to a single call of match_batch */
+#define XCMD_BATCH 256
+
+/* Cached match set of an input */
+struct xcmd_cache_entry
+{
+  xcentry_t *prev;
+  xcentry_t *next;
+  char *input;
+  /* Positions of the matches in items.index */
+  dbitmap_t matches;
+  /* Ranks of the matches in order of position, NULL unless match_ranked */
+  guint8 *ranks;
+  /* Number of bytes used by the entry */
+  size_t size;
+};
+
+/* Start of the next item in a chunk */
+#define xcmd_chunk_text(chunk) ((chunk)->data + (chunk)->used + sizeof(xheader_t))
 
 void xcmd_init(xcmd_t *ptr, const xcfg_t *cfg)
 {
@@ -17,14 +152,24 @@ void xcmd_init(xcmd_t *ptr, const xcfg_t *cfg)
 
   /* Initialize items */
   ptr->items.index = NULL;
-  ptr->items.data  = 0;
+  ptr->items.allocated = 0;
+  ptr->items.chunks = NULL;
+  ptr->items.last = NULL;
+  ptr->items.size = 0;
+  ptr->items.capacity = 0;
+  ptr->items.sources = NULL;
   ptr->items.count = 0;
   ptr->matches.index   = NULL;
   ptr->matches.shadow  = NULL;
+  ptr->matches.ranks   = NULL;
+  ptr->matches.buckets = NULL;
+  ptr->matches.positions = NULL;
   ptr->matches.count = 0;
   ptr->matches.selected = 0;
   ptr->matches.input = NULL;
   ptr->matches.complete = g_string_new(NULL);
+  ptr->matches.generation = 0;
+  ptr->matches.scanned = 0;
 
   /* Select appropriate configuration */
   debug("Apply %s configuration.", cfg ? "default" : "user");
@@ -34,6 +179,43 @@ void xcmd_init(xcmd_t *ptr, const xcfg_t *cfg)
     cfg = &default_config;
   } /* if ... */
 
+  /* Pagination */
+  debug("Match %lu items per page.", cfg->page);
+  ptr->matches.page = cfg->page;
+
+  /* Cache of match sets */
+  debug("Cache up to %lu bytes of match sets.", cfg->cache);
+  ptr->cache.entries = cfg->cache ? g_hash_table_new(g_str_hash, g_str_equal) : NULL;
+  ptr->cache.first = NULL;
+  ptr->cache.last = NULL;
+  ptr->cache.size = 0;
+  ptr->cache.capacity = cfg->cache;
+  ptr->cache.hits = 0;
+  ptr->cache.prefix_hits = 0;
+  ptr->cache.misses = 0;
+
+  /* Sort order */
+  debug("Sort items in order %i.", cfg->sort);
+  ptr->items.sort = cfg->sort;
+  warn_if(xcmd_sort_locale == cfg->sort && !setlocale(LC_COLLATE, ""), "No locale support: %m");
+
+  /* Duplicates */
+  debug("%s duplicate items.", cfg->unique ? "Drop" : "Keep");
+  ptr->items.unique = cfg->unique ? g_hash_table_new(xcmd_hash_item, xcmd_equal_items) : NULL;
+
+  /* Fields */
+  xfield_t field;
+  ptr->fields.delimiter = cfg->delimiter;
+  ptr->fields.spans = NULL;
+  ptr->fields.print_index = cfg->print_index;
+  ptr->fields.print_source = cfg->print_source;
+  ptr->fields.output = g_string_new(NULL);
+
+  for(field = 0; field < xcmd_field_count; field += 1) {
+    const int failed = xcmd_parse_fields(cfg->fields[field], &ptr->fields.first[field], &ptr->fields.last[field]);
+    die_if(failed, "Invalid field selection `%s'!", cfg->fields[field]);
+  } /* for ... */
+
   /* String comparison */
   debug("String comparison: case-%ssensitive", cfg->case_insensitive ? "in" : "");
   if(cfg->case_insensitive) {
@@ -63,6 +245,9 @@ void xcmd_init(xcmd_t *ptr, const xcfg_t *cfg)
       ptr->match_init = NULL;
       ptr->match_free = NULL;
       ptr->match = match_prefix;
+      ptr->match_batch = cfg->case_insensitive ? match_prefix_batch_icase : match_prefix_batch_case;
+      ptr->match_ranked = 0;
+      ptr->match_monotonic = 1;
       break;
 
     case xcmd_match_strip_prefix:
@@ -70,13 +255,38 @@ void xcmd_init(xcmd_t *ptr, const xcfg_t *cfg)
       ptr->match_init = NULL;
       ptr->match_free = NULL;
       ptr->match = match_strip_prefix;
+      ptr->match_batch = cfg->case_insensitive ? match_strip_prefix_batch_icase : match_strip_prefix_batch_case;
+      ptr->match_ranked = 0;
+      ptr->match_monotonic = 1;
       break;
 
     case xcmd_match_regex:
-      debug("Match items on regular expression.");
-      ptr->match_init = cfg->case_insensitive ? match_regex_init_icase : match_regex_init_case;
-      ptr->match_free = match_regex_free;
-      ptr->match = match_regex;
+      if(xcmd_regex_pcre == cfg->regex) {
+        debug("Match items on Perl compatible regular expression.");
+        ptr->match_init = cfg->case_insensitive ? match_gregex_init_icase : match_gregex_init_case;
+        ptr->match_free = match_gregex_free;
+        ptr->match = match_gregex;
+        ptr->match_batch = match_gregex_batch;
+      } else {
+        debug("Match items on regular expression.");
+        ptr->match_init = cfg->case_insensitive ? match_regex_init_icase : match_regex_init_case;
+        ptr->match_free = match_regex_free;
+        ptr->match = match_regex;
+        ptr->match_batch = match_regex_batch;
+      } /* if ... */
+
+      ptr->match_ranked = 0;
+      ptr->match_monotonic = 0;
+      break;
+
+    case xcmd_match_tokens:
+      debug("Match items containing all tokens.");
+      ptr->match_init = cfg->case_insensitive ? match_tokens_init_icase : match_tokens_init_case;
+      ptr->match_free = match_tokens_free;
+      ptr->match = match_tokens;
+      ptr->match_batch = match_tokens_batch;
+      ptr->match_ranked = 1;
+      ptr->match_monotonic = 1;
       break;
 
     /* As the match-function is required, fail here */
@@ -88,6 +298,9 @@ void xcmd_init(xcmd_t *ptr, const xcfg_t *cfg)
   ptr->observer = NULL;
   ptr->observer_data = NULL;
   ptr->has_changed = 0;
+
+  /* Prompt */
+  ptr->prompt = NULL;
 }
 
 void xcmd_destroy(xcmd_t *ptr)
@@ -101,19 +314,50 @@ void xcmd_destroy(xcmd_t *ptr)
     ptr->complete_data = NULL;
   } /* if ... */
 
+  /* Release data of a pending scan */
+  xcmd_stop_matching(ptr);
+
+  /* Free cached match sets */
+  xcmd_cache_evict(ptr, 0);
+  if(ptr->cache.entries) g_hash_table_destroy(ptr->cache.entries);
+  ptr->cache.entries = NULL;
+
   /* Free items */
+  while(ptr->items.chunks) {
+    xchunk_t *next = ptr->items.chunks->next;
+    free(ptr->items.chunks);
+    ptr->items.chunks = next;
+  } /* while ... */
+
+  if(ptr->items.unique) g_hash_table_destroy(ptr->items.unique);
+  if(ptr->items.sources) g_array_free(ptr->items.sources, TRUE);
   free(ptr->items.index);
-  free(ptr->items.data);
   free(ptr->matches.index);
   free(ptr->matches.shadow);
+  free(ptr->matches.ranks);
+  free(ptr->matches.buckets);
+  free(ptr->matches.positions);
+  ptr->items.unique = NULL;
+  ptr->items.sources = NULL;
   ptr->items.index = NULL;
-  ptr->items.data = NULL;
+  ptr->items.allocated = 0;
+  ptr->items.last = NULL;
+  ptr->items.count = 0;
+  ptr->items.size = 0;
+  ptr->items.capacity = 0;
   ptr->matches.index  = NULL;
   ptr->matches.shadow = NULL;
+  ptr->matches.ranks = NULL;
+  ptr->matches.buckets = NULL;
+  ptr->matches.positions = NULL;
   ptr->matches.count = 0;
   ptr->matches.selected = 0;
   g_string_free(ptr->matches.complete, TRUE);
   ptr->matches.complete = NULL;
+  free(ptr->fields.spans);
+  ptr->fields.spans = NULL;
+  g_string_free(ptr->fields.output, TRUE);
+  ptr->fields.output = NULL;
 
   /* Model functions */
   ptr->strncmp = NULL;
@@ -129,6 +373,7 @@ void xcmd_destroy(xcmd_t *ptr)
   ptr->match_free = NULL;
   ptr->match_data = NULL;
   ptr->match = NULL;
+  ptr->match_batch = NULL;
 
   /* MVC */
   ptr->observer = NULL;
@@ -146,72 +391,676 @@ int xcmd_read_items(xcmd_t *ptr, FILE *f)
   assert(f);
   debug("Read items from input stream.");
 
-  /* Dynamic buffer, that will be saved in ptr. */
-  assert2(!ptr->items.data, "Items have already been initialized!");
-  ptr->items.count = 0;
-  const size_t block_size = 1024;
-  size_t buffer_max_size = 0;
-  size_t buffer_size = 0;
-
-  char *line = NULL;
-  size_t line_size = 0;
-  ssize_t n_bytes = 0;
-
-  while(0 < (n_bytes = getline(&line, &line_size, f))) {
-    /* Remove trailing newline character */
-    *(line + n_bytes - 1) = '\0';
-
-    /* Grow buffer */
-    const size_t old_buffer_size = buffer_size;
-    buffer_size += n_bytes;
-
-    if(buffer_max_size <= buffer_size) {
-      const size_t n_blocks = 1 + buffer_size / block_size;
-      buffer_max_size = n_blocks * block_size;
-      ptr->items.data = (char*)xrealloc(ptr->items.data, buffer_max_size);
+  /* Lines are read directly into the arena */
+  assert2(!ptr->matches.index, "Items have already been finished!");
+  xchunk_t *chunk = NULL;
+  size_t n = 0;
+
+  /* Detect compressed streams by their magic bytes */
+  guint8 magic[4];
+  const size_t m = fread(magic, 1, sizeof(magic), f);
+  int format = XCMD_PLAIN;
+
+  if(2 <= m && 0x1f == magic[0] && 0x8b == magic[1]) format = XCMD_GZIP;
+  if(4 == m && 0x28 == magic[0] && 0xb5 == magic[1] && 0x2f == magic[2] && 0xfd == magic[3]) format = XCMD_ZSTD;
+
+  if(XCMD_PLAIN != format) {
+    const int status = xcmd_read_compressed(ptr, &chunk, &n, f, magic, m, format);
+
+    /* Last line without newline character */
+    if(n) xcmd_commit_item(ptr, chunk, n);
+    return status;
+  } /* if ... */
+
+  xcmd_append_text(ptr, &chunk, &n, (const char*)magic, m);
+
+  while(1) {
+    if(!n) chunk = xcmd_reserve_item(ptr, line_min);
+
+    char *line = xcmd_chunk_text(chunk);
+    const size_t avail = chunk->size - chunk->used - sizeof(xheader_t);
+    if(!fgets(line + n, MIN(avail - n, INT_MAX), f)) break;
+    n += strlen(line + n);
+
+    if(n && '\n' == *(line + n - 1)) {
+      /* Remove trailing newline character */
+      xcmd_commit_item(ptr, chunk, n - 1);
+      n = 0;
+
+    } else if(avail == n + 1) {
+      chunk = xcmd_grow_item(ptr, chunk, n, 2 * avail);
+
+    } /* if ... */
+  } /* while ... */
+
+  /* Items read before an error are kept, e.g. of a connection reset */
+  const int failed = ferror(f);
+  warn_if(failed, "Cannot read input: %m");
+
+  /* Last line without newline character */
+  if(n) xcmd_commit_item(ptr, chunk, n);
+
+  return failed ? -1 : 0;
+}
+
+/* Split text into lines and commit every complete one. The n bytes of an
+ * incomplete line are kept in chunk for the next call. */
+void xcmd_append_text(xcmd_t *ptr, xchunk_t **chunk, size_t *n, const char *text, size_t length)
+{
+  assert(ptr);
+  assert(chunk);
+  assert(n);
+
+  while(length) {
+    if(!*n) *chunk = xcmd_reserve_item(ptr, line_min);
+
+    const char *eol = (const char*)memchr(text, '\n', length);
+    const size_t k = eol ? (size_t)(eol - text) : length;
+    const size_t avail = (*chunk)->size - (*chunk)->used - sizeof(xheader_t);
+
+    /* One byte is kept for the terminating null character */
+    if(avail < *n + k + 1) *chunk = xcmd_grow_item(ptr, *chunk, *n, MAX(2 * avail, *n + k + 1));
+
+    memcpy(xcmd_chunk_text(*chunk) + *n, text, k);
+    *n += k;
+    text += k;
+    length -= k;
+
+    if(eol) {
+      xcmd_commit_item(ptr, *chunk, *n);
+      *n = 0;
+      text += 1;
+      length -= 1;
+    } /* if ... */
+  } /* while ... */
+}
+
+/* Provide at least required bytes for the n bytes of the line in chunk */
+xchunk_t *xcmd_grow_item(xcmd_t *ptr, xchunk_t *chunk, size_t n, size_t required)
+{
+  assert(ptr);
+  assert(chunk);
+
+  if(ptr->items.last != chunk) {
+    /* Line already has a chunk of its own, which is the first one */
+    const size_t size = MAX(2 * chunk->size, sizeof(xheader_t) + required);
+    ptr->items.capacity += size - chunk->size;
+    chunk->size = size;
+    chunk = (xchunk_t*)xrealloc(chunk, sizeof(xchunk_t) + chunk->size);
+    ptr->items.chunks = chunk;
+
+  } else {
+    /* Line exceeds the chunk, so move it to a larger one */
+    xchunk_t *next = xcmd_reserve_item(ptr, required);
+    memcpy(xcmd_chunk_text(next), xcmd_chunk_text(chunk), n);
+    chunk = next;
+
+  } /* if ... */
+
+  return chunk;
+}
+
+static gpointer xcmd_inflate_worker(gpointer data)
+{
+  xinflatejob_t *job = (xinflatejob_t*)data;
+
+  /* Input starts with the bytes read to detect the format */
+  const size_t size = inflate_block;
+  char *in = (char*)xmalloc(size);
+  size_t position = 0;
+  size_t avail = job->m;
+  int eof = 0;
+  int more = 0;
+  int finished = 0;
+  int supported = 0;
+  memcpy(in, job->magic, job->m);
+
+  GConverter *converter = NULL;
+  if(XCMD_GZIP == job->format) {
+    converter = G_CONVERTER(g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_GZIP));
+    supported = 1;
+  } /* if ... */
+
+#ifdef ZSTD
+  ZSTD_DStream *dstream = NULL;
+  size_t hint = 1;
+  if(XCMD_ZSTD == job->format) {
+    dstream = ZSTD_createDStream();
+    ZSTD_initDStream(dstream);
+    supported = 1;
+  } /* if ... */
+#endif /* ZSTD */
+
+  if(!supported) {
+    warning("Cannot decompress input: %s", "format not supported");
+    job->status = 1;
+  } /* if ... */
+
+  xblock_t *block = (xblock_t*)g_async_queue_pop(job->free);
+  block->length = 0;
+
+  while(supported) {
+    /* Refill input, keeping bytes not consumed yet */
+    if(!eof && (!avail || more || (finished && avail < 2))) {
+      if(size == avail) {
+        warning("Cannot decompress input: %s", "line of compressed data exceeds buffer");
+        job->status = 1;
+        break;
+      } /* if ... */
+
+      memmove(in, in + position, avail);
+      position = 0;
+      const size_t k = fread(in + avail, 1, size - avail, job->f);
+      avail += k;
+      eof = !k;
+      more = 0;
+    } /* if ... */
+
+    if(finished) {
+      /* Concatenated members follow with a header of their own, anything else
+       * is ignored like gzip(1) does */
+      if(avail < 2 || 0x1f != (guint8)in[position] || 0x8b != (guint8)in[position + 1]) break;
+      g_converter_reset(converter);
+      finished = 0;
+    } /* if ... */
+
+    /* Pass full blocks on to be indexed */
+    if(inflate_block == block->length) {
+      g_async_queue_push(job->full, block);
+      block = (xblock_t*)g_async_queue_pop(job->free);
+      block->length = 0;
+    } /* if ... */
+
+    if(converter) {
+      GError *error = NULL;
+      gsize read = 0;
+      gsize written = 0;
+      const GConverterResult result = g_converter_convert(converter,
+          in + position, avail, block->data + block->length, inflate_block - block->length,
+          eof ? G_CONVERTER_INPUT_AT_END : G_CONVERTER_NO_FLAGS, &read, &written, &error);
+
+      if(G_CONVERTER_ERROR == result && !eof && g_error_matches(error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT)) {
+        /* More input is required */
+        g_error_free(error);
+        more = 1;
+        continue;
+
+      } else if(G_CONVERTER_ERROR == result) {
+        /* `g_converter_convert' failed */
+        warning("Cannot decompress input: %s", error->message);
+        g_error_free(error);
+        job->status = 1;
+        break;
+
+      } /* if ... */
+
+      position += read;
+      avail -= read;
+      block->length += written;
+      finished = (G_CONVERTER_FINISHED == result);
+    } /* if ... */
+
+#ifdef ZSTD
+    if(dstream) {
+      /* Frames follow each other without any reset, until the last one has
+       * been flushed completely */
+      if(eof && !avail && !hint) break;
+
+      ZSTD_inBuffer input = { in + position, avail, 0 };
+      ZSTD_outBuffer output = { block->data + block->length, inflate_block - block->length, 0 };
+      hint = ZSTD_decompressStream(dstream, &output, &input);
+
+      if(ZSTD_isError(hint)) {
+        /* `ZSTD_decompressStream' failed */
+        warning("Cannot decompress input: %s", ZSTD_getErrorName(hint));
+        job->status = 1;
+        break;
+      } /* if ... */
+
+      position += input.pos;
+      avail -= input.pos;
+      block->length += output.pos;
+
+      if(eof && !avail && hint && output.pos < output.size) {
+        warning("Cannot decompress input: %s", "truncated frame");
+        job->status = 1;
+        break;
+      } /* if ... */
+    } /* if ... */
+#endif /* ZSTD */
+  } /* while ... */
+
+  if(ferror(job->f)) {
+    warning("Cannot read input: %m");
+    job->status = 1;
+  } /* if ... */
+
+  /* Text decompressed so far is indexed even on errors */
+  if(block->length) {
+    g_async_queue_push(job->full, block);
+    block = (xblock_t*)g_async_queue_pop(job->free);
+  } /* if ... */
+
+  block->length = 0;
+  g_async_queue_push(job->full, block);
+
+  if(converter) g_object_unref(converter);
+#ifdef ZSTD
+  if(dstream) ZSTD_freeDStream(dstream);
+#endif /* ZSTD */
+  free(in);
+  return NULL;
+}
+
+int xcmd_read_compressed(xcmd_t *ptr, xchunk_t **chunk, size_t *n, FILE *f, const guint8 *magic, size_t m, int format)
+{
+  assert(ptr);
+  assert(f);
+  debug("Decompress items from input stream.");
+
+  xinflatejob_t job;
+  size_t i;
+
+  job.f = f;
+  job.format = format;
+  memcpy(job.magic, magic, m);
+  job.m = m;
+  job.full = g_async_queue_new();
+  job.free = g_async_queue_new();
+  job.status = 0;
+
+  for(i = 0; i < XCMD_INFLATE_BLOCKS; i += 1) {
+    g_async_queue_push(job.free, xmalloc(sizeof(xblock_t) + inflate_block));
+  } /* for ... */
+
+  /* Lines are indexed, while the next blocks are decompressed */
+  GThread *thread = g_thread_new("inflate", xcmd_inflate_worker, &job);
+  xblock_t *block;
+
+  while((block = (xblock_t*)g_async_queue_pop(job.full))->length) {
+    xcmd_append_text(ptr, chunk, n, block->data, block->length);
+    g_async_queue_push(job.free, block);
+  } /* while ... */
+
+  g_async_queue_push(job.free, block);
+  g_thread_join(thread);
+
+  for(i = 0; i < XCMD_INFLATE_BLOCKS; i += 1) {
+    free(g_async_queue_pop(job.free));
+  } /* for ... */
+
+  g_async_queue_unref(job.full);
+  g_async_queue_unref(job.free);
+  return job.status;
+}
+
+static gpointer xcmd_read_worker(gpointer data)
+{
+  xreadjob_t *job = (xreadjob_t*)data;
+
+  job->status = xcmd_read_items(&job->segment, job->f);
+  return NULL;
+}
+
+int xcmd_read_streams(xcmd_t *ptr, FILE **streams, size_t n)
+{
+  assert(ptr);
+  assert(streams);
+  assert2(!ptr->matches.index, "Items have already been finished!");
+  debug("Read items from %lu streams.", n);
+
+  /* Segments only hold items, until they are merged */
+  xreadjob_t *jobs = (xreadjob_t*)xmalloc(n * sizeof(xreadjob_t));
+  xcfg_t cfg;
+  size_t i;
+  int status = 0;
+
+  xcmd_config_default(&cfg);
+  cfg.cache = 0;
+
+  /* Duplicates within a source are never committed to its segment */
+  cfg.unique = (NULL != ptr->items.unique);
+
+  for(i = 0; i < n; i += 1) {
+    xcmd_init(&jobs[i].segment, &cfg);
+    jobs[i].f = streams[i];
+    jobs[i].status = 0;
+    jobs[i].thread = g_thread_new("source", xcmd_read_worker, &jobs[i]);
+  } /* for ... */
+
+  /* Items read before form a source of their own */
+  if(!ptr->items.sources) ptr->items.sources = g_array_new(FALSE, FALSE, sizeof(size_t));
+  if(ptr->items.count) g_array_append_val(ptr->items.sources, ptr->items.count);
+
+  /* Merge in order of streams, while later streams are still read */
+  for(i = 0; i < n; i += 1) {
+    g_thread_join(jobs[i].thread);
+    status |= jobs[i].status;
+
+    xcmd_merge_items(ptr, &jobs[i].segment);
+    g_array_append_val(ptr->items.sources, ptr->items.count);
+    xcmd_destroy(&jobs[i].segment);
+  } /* for ... */
+
+  free(jobs);
+  return status;
+}
+
+/* Move the items of segment behind all items, so they are numbered as if they
+ * were read right after them */
+void xcmd_merge_items(xcmd_t *ptr, xcmd_t *segment)
+{
+  assert(ptr);
+  assert(segment);
+  debug("Merge %lu items of segment.", segment->items.count);
+
+  size_t i;
+  for(i = 0; i < segment->items.count; i += 1) {
+    char *item = *(segment->items.index + i);
+
+    /* Duplicates of items of earlier sources are dropped from the index,
+     * their bytes are kept */
+    if(ptr->items.unique && g_hash_table_contains(ptr->items.unique, item)) continue;
+    if(ptr->items.unique) g_hash_table_add(ptr->items.unique, item);
+
+    xheader_t header;
+    memcpy(&header, item - sizeof(header), sizeof(header));
+    header.id = ptr->items.count;
+    memcpy(item - sizeof(header), &header, sizeof(header));
+
+    if(ptr->items.allocated == ptr->items.count) {
+      ptr->items.allocated = ptr->items.allocated ? 2 * ptr->items.allocated : 1024;
+      ptr->items.index = (char**)xrealloc(ptr->items.index, ptr->items.allocated * sizeof(char*));
     } /* if ... */
 
-    memcpy(ptr->items.data + old_buffer_size, line, n_bytes);
+    *(ptr->items.index + ptr->items.count) = item;
     ptr->items.count += 1;
+  } /* for ... */
+
+  /* Chunks of the segment are moved to the front, so items are never
+   * appended to them */
+  if(segment->items.chunks) {
+    xchunk_t *tail = segment->items.chunks;
+    while(tail->next) tail = tail->next;
+
+    tail->next = ptr->items.chunks;
+    ptr->items.chunks = segment->items.chunks;
+  } /* if ... */
+
+  ptr->items.size += segment->items.size;
+  ptr->items.capacity += segment->items.capacity;
+  segment->items.chunks = NULL;
+  segment->items.last = NULL;
+  segment->items.size = 0;
+  segment->items.capacity = 0;
+}
+
+size_t xcmd_item_source(const xcmd_t *ptr, const char *item)
+{
+  assert(ptr);
+  assert(item);
+
+  if(!ptr->items.sources) return 0;
 
+  /* Binary search on the end of each source */
+  const size_t id = xcmd_item_id(item);
+  size_t lo = 0;
+  size_t hi = ptr->items.sources->len;
+
+  while(lo < hi) {
+    const size_t mid = (lo + hi) / 2;
+
+    if(id < g_array_index(ptr->items.sources, size_t, mid)) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    } /* if ... */
   } /* while ... */
-  assert2(feof(f), "Cannot read input: %m");
 
-  free(line);
-  line = NULL;
+  return lo;
+}
+
+int xcmd_add_item(xcmd_t *ptr, const char *text, size_t n)
+{
+  assert(ptr);
+  assert(text);
+  assert2(!ptr->matches.index, "Items have already been finished!");
+
+  xchunk_t *chunk = xcmd_reserve_item(ptr, n + 1);
+  memcpy(xcmd_chunk_text(chunk), text, n);
+  xcmd_commit_item(ptr, chunk, n);
 
   return 0;
 }
 
+static xchunk_t *xcmd_reserve_item(xcmd_t *ptr, size_t n)
+{
+  assert(ptr);
+
+  /* Reserve the header and n bytes following it */
+  const size_t required = sizeof(xheader_t) + n;
+  xchunk_t *last = ptr->items.last;
+
+  if(last && required <= last->size - last->used) return last;
+
+  /* Chunks grow geometrically, so there are only few of them */
+  size_t size = last ? MIN(2 * last->size, chunk_max) : chunk_min;
+  if(size < required) size = required;
+
+  xchunk_t *chunk = (xchunk_t*)xmalloc(sizeof(xchunk_t) + size);
+  chunk->size = size;
+  chunk->used = 0;
+  ptr->items.capacity += size;
+
+  if(last && chunk_max < required) {
+    /* Oversized items get a chunk of their own, so the space left in the last
+     * chunk is not wasted. */
+    chunk->next = ptr->items.chunks;
+    ptr->items.chunks = chunk;
+
+  } else {
+    /* New chunks follow the last one, or lead the list without one. Chunks
+     * of merged segments and oversized items stay linked either way. */
+    chunk->next = last ? last->next : ptr->items.chunks;
+    if(last) last->next = chunk;
+    else ptr->items.chunks = chunk;
+    ptr->items.last = chunk;
+
+  } /* if ... */
+
+  debug("Allocate chunk of %lu bytes for items.", size);
+  return chunk;
+}
+
+static void xcmd_commit_item(xcmd_t *ptr, xchunk_t *chunk, size_t n)
+{
+  assert(ptr);
+  assert(chunk);
+
+  /* The text has already been written to the chunk */
+  const xheader_t header = { .id = ptr->items.count, .length = n };
+  const size_t required = sizeof(header) + n + 1;
+  char *item = xcmd_chunk_text(chunk);
+  memcpy(item - sizeof(header), &header, sizeof(header));
+  *(item + n) = '\0';
+
+  /* Duplicates are never committed, so their bytes are reused */
+  if(ptr->items.unique && g_hash_table_contains(ptr->items.unique, item)) {
+    if(ptr->items.last != chunk) {
+      /* Release the chunk of an oversized item, which is the first one */
+      ptr->items.chunks = chunk->next;
+      ptr->items.capacity -= chunk->size;
+      free(chunk);
+    } /* if ... */
+
+    return;
+  } /* if ... */
+
+  /* Shrink chunks of oversized items before they are indexed */
+  if(ptr->items.last != chunk && required < chunk->size) {
+    ptr->items.capacity -= chunk->size - required;
+    chunk->size = required;
+    chunk = (xchunk_t*)xrealloc(chunk, sizeof(xchunk_t) + chunk->size);
+    ptr->items.chunks = chunk;
+    item = xcmd_chunk_text(chunk);
+  } /* if ... */
+
+  chunk->used += required;
+  ptr->items.size += required;
+  assert(chunk->used <= chunk->size);
+
+  if(ptr->items.unique) g_hash_table_add(ptr->items.unique, item);
+
+  /* Items never move, so they are indexed right away */
+  if(ptr->items.allocated == ptr->items.count) {
+    ptr->items.allocated = ptr->items.allocated ? 2 * ptr->items.allocated : 1024;
+    ptr->items.index = (char**)xrealloc(ptr->items.index, ptr->items.allocated * sizeof(char*));
+  } /* if ... */
+
+  *(ptr->items.index + ptr->items.count) = item;
+  ptr->items.count += 1;
+}
+
+static guint xcmd_hash_item(gconstpointer item)
+{
+  assert(item);
+
+  /* FNV-1a over the bytes of the item */
+  const unsigned char *it = (const unsigned char*)item;
+  const unsigned char *const end = it + xcmd_item_length((const char*)item);
+  guint32 hash = 2166136261u;
+
+  for(; end != it; it += 1) {
+    hash ^= *it;
+    hash *= 16777619u;
+  } /* for ... */
+
+  return hash;
+}
+
+static gboolean xcmd_equal_items(gconstpointer a, gconstpointer b)
+{
+  assert(a);
+  assert(b);
+
+  const size_t n = xcmd_item_length((const char*)a);
+  return n == xcmd_item_length((const char*)b) && !memcmp(a, b, n);
+}
+
+size_t xcmd_item_id(const char *item)
+{
+  assert(item);
+
+  xheader_t header;
+  memcpy(&header, item - sizeof(header), sizeof(header));
+  return header.id;
+}
+
+size_t xcmd_item_length(const char *item)
+{
+  assert(item);
+
+  xheader_t header;
+  memcpy(&header, item - sizeof(header), sizeof(header));
+  return header.length;
+}
+
+const char *xcmd_item_field(const xcmd_t *ptr, const char *item, xfield_t field, size_t *n)
+{
+  assert(ptr);
+  assert(item);
+  assert(n);
+  assert(field < xcmd_field_count);
+
+  /* Whole item is selected */
+  if(!ptr->fields.spans || !ptr->fields.first[field]) {
+    *n = xcmd_item_length(item);
+    return item;
+  } /* if ... */
+
+  const xspan_t *span = ptr->fields.spans + xcmd_item_id(item) * xcmd_field_count + field;
+  *n = span->length;
+  return item + span->offset;
+}
+
+const char *xcmd_item_output(xcmd_t *ptr, const char *item)
+{
+  assert(ptr);
+  assert(item);
+
+  g_string_truncate(ptr->fields.output, 0);
+
+  /* Source comes first, separated like a field */
+  if(ptr->fields.print_source) {
+    g_string_append_printf(ptr->fields.output, "%lu%c", xcmd_item_source(ptr, item), ptr->fields.delimiter);
+  } /* if ... */
+
+  if(ptr->fields.print_index) {
+    g_string_append_printf(ptr->fields.output, "%lu", xcmd_item_id(item));
+
+  } else {
+    size_t n = 0;
+    const char *text = xcmd_item_field(ptr, item, xcmd_field_output, &n);
+    g_string_append_len(ptr->fields.output, text, n);
+
+  } /* if ... */
+
+  return ptr->fields.output->str;
+}
+
 int xcmd_finish_items(xcmd_t *ptr)
 {
   assert(ptr);
   debug("Finish list of items.");
 
   /* Allocate indexes */
-  assert2(!ptr->items.index, "Items have already been finished!");
+  assert2(!ptr->matches.index, "Items have already been finished!");
   assert2(0 < ptr->items.count, "No data!");
-  ptr->items.index = (char**)xmalloc(ptr->items.count * sizeof(char*));
+
+  /* No more items will be added */
+  if(ptr->items.unique) {
+    g_hash_table_destroy(ptr->items.unique);
+    ptr->items.unique = NULL;
+  } /* if ... */
+
   ptr->matches.index  = (char**)xmalloc(ptr->items.count * sizeof(char*));
   ptr->matches.shadow = (char**)xmalloc(ptr->items.count * sizeof(char*));
+  ptr->matches.ranks = (guint8*)xmalloc(ptr->items.count * sizeof(guint8));
+  ptr->matches.buckets = (char**)xmalloc(ptr->items.count * sizeof(char*));
+  ptr->matches.positions = (guint32*)xmalloc(ptr->items.count * sizeof(guint32));
   ptr->matches.count = ptr->items.count;
   ptr->matches.selected = 0;
 
-  /* Fill indexes */
-  char *x = ptr->items.data;
+  /* Field ranges are only required, if any selection is not the whole item */
+  xfield_t field;
+  int use_fields = 0;
+
+  for(field = 0; field < xcmd_field_count; field += 1) {
+    use_fields |= (0 != ptr->fields.first[field]);
+  } /* for ... */
+
+  if(use_fields) {
+    ptr->fields.spans = (xspan_t*)xmalloc(ptr->items.count * xcmd_field_count * sizeof(xspan_t));
+  } /* if ... */
+
+  /* Check items and find their fields */
   char **it = ptr->items.index;
   char **const end = ptr->items.index + ptr->items.count;
 
   for(it = ptr->items.index; end != it; it += 1) {
-    *it = x;
-    /* Advance buffer by length of string and the NUL-byte */
-    const size_t len = strlen(x);
-    x += 1 + len;
-
+    const size_t len = xcmd_item_length(*it);
     assert2(TRUE == g_utf8_validate(*it, len, NULL), "Found invalid UTF-8 string in element %lu!", it - ptr->items.index);
+
+    if(ptr->fields.spans) {
+      xcmd_find_fields(ptr, *it, len, ptr->fields.spans + (it - ptr->items.index) * xcmd_field_count);
+    } /* if ... */
   } /* for ... */
 
+  /* Sort once, matching preserves the order */
+  if(xcmd_sort_none != ptr->items.sort) xcmd_sort_items(ptr);
+
   memcpy(ptr->matches.index, ptr->items.index, ptr->items.count * sizeof(char*));
+  ptr->matches.generation += 1;
 
   /* Update auto-complete data */
   if(ptr->complete_init) ptr->complete_data = ptr->complete_init(ptr);
@@ -228,12 +1077,28 @@ int xcmd_update_matching(xcmd_t *ptr, const char *input)
   assert(ptr);
   debug("Update matching items using input ˋ%s'.", input);
   
+  const gint64 begin = stats_now();
   const size_t old_count = ptr->matches.count;
+  size_t ranked[XCMD_RANKS] = { 0 };
+  xcentry_t *entry = NULL;
+  trace_begin("xcmd_update_matching");
+
+  /* Abandon scanning for previous input */
+  xcmd_stop_matching(ptr);
 
   if(!input || !strlen(input)) {
     /* Select all items, if input is empty */
     memcpy(ptr->matches.shadow, ptr->items.index, ptr->items.count * sizeof(char*));
     ptr->matches.count = ptr->items.count;
+    ptr->matches.scanned = ptr->items.count;
+
+  } else if((entry = xcmd_cache_lookup(ptr, input))) {
+    /* Restore matches of a cached input without matching */
+    ptr->cache.hits += 1;
+    stats_count(dstats_cache_hits, 1);
+    ptr->match_ok = 1;  /* Only inputs matched successfully are cached */
+    xcmd_cache_restore(ptr, entry, ranked);
+    xcmd_rank_matches(ptr, ranked);
 
   } else {
     /* Select from matching items */
@@ -248,83 +1113,440 @@ int xcmd_update_matching(xcmd_t *ptr, const char *input)
     } /* if ... */
 
     /* No changes will occur, if the data isn't usable */
-    if(!ptr->match_ok) return -1;
+    if(!ptr->match_ok) {
+      ptr->matches.scanned = ptr->items.count;
+      trace_end("xcmd_update_matching");
+      return -1;
+    } /* if ... */
 
     /* Require match-function to be set */
     assert(ptr->match);
 
-    char **it;
-    char **const end = ptr->items.index + ptr->items.count;
     ptr->matches.count = 0;
+    ptr->matches.scanned = 0;
+    ptr->matches.input = input;
+
+    /* Items not matching a prefix of the input can't match the input */
+    const xcentry_t *candidates = ptr->match_monotonic ? xcmd_cache_lookup_prefix(ptr, input) : NULL;
 
     /* Use double buffering-tchnique to calculate matches */
-    for(it = ptr->items.index; end != it; it += 1) {
-      /* If item doesn't match the input, go to the next one. */
-      if(!ptr->match(ptr, input, *it, ptr->match_data)) continue;
+    if(candidates) {
+      ptr->cache.prefix_hits += 1;
+      stats_count(dstats_cache_prefix_hits, 1);
+      xcmd_scan_candidates(ptr, &candidates->matches, ranked);
 
-      *(ptr->matches.shadow + ptr->matches.count) = *it;
-      ptr->matches.count += 1;
-    } /* for ... */
+    } else {
+      /* Fill the visible page and one page of lookahead first, unless ranks
+       * require all items */
+      const size_t count = (ptr->matches.page && !ptr->match_ranked) ? 2 * ptr->matches.page : G_MAXSIZE;
+
+      if(ptr->cache.entries) {
+        ptr->cache.misses += 1;
+        stats_count(dstats_cache_misses, 1);
+      } /* if ... */
 
-    if(ptr->match_free) {
-      ptr->match_free(ptr, ptr->match_data);
-      ptr->match_data = NULL;
+      xcmd_scan_items(ptr, ptr->matches.shadow, count, G_MAXSIZE, ranked);
+
+    } /* if ... */
+
+    xcmd_rank_matches(ptr, ranked);
+
+    if(ptr->items.count == ptr->matches.scanned) {
+      xcmd_cache_insert(ptr);
+      xcmd_stop_matching(ptr);
     } /* if ... */
   } /* if ... */
 
+  stats_count(dstats_matches, ptr->matches.count);
+  stats_record(dstats_match, begin);
+  trace("matches", ptr->items.count, ptr->matches.count, ptr->matches.generation);
+
   /* Select first matching item */
   ptr->matches.selected = 0;
   ptr->matches.input = input;
 
   /* Detect changes to double buffer */
-  ptr->has_changed |= (old_count != ptr->matches.count) 
+  const int set_changed = (old_count != ptr->matches.count)
       || memcmp(ptr->matches.index, ptr->matches.shadow, ptr->matches.count * sizeof(char*));
 
+  ptr->has_changed |= set_changed;
+  if(set_changed) ptr->matches.generation += 1;
+
   memcpy(ptr->matches.index, ptr->matches.shadow, ptr->matches.count * sizeof(char*));
+  trace_end("xcmd_update_matching");
   xcmd_notify_observer(ptr);
 
   return 0;
 }
 
-int xcmd_update_selected(xcmd_t *ptr, const long offset, const int relative)
+int xcmd_continue_matching(xcmd_t *ptr, size_t count, size_t budget)
 {
   assert(ptr);
-  debug("Update selected item.");
 
-  /* An offset of 0 doesn't change anything */
-  if(!offset && relative) return 0;
+  /* Nothing left to scan */
+  if(ptr->items.count == ptr->matches.scanned) return 0;
+  if(count <= ptr->matches.count) return 1;
 
-  /* No data */
-  if(!ptr->matches.count) return 0;
+  debug("Continue matching at item %lu.", ptr->matches.scanned);
+  trace_begin("xcmd_continue_matching");
 
-  const size_t old_selected_item = ptr->matches.selected;
+  /* Matches are appended, so they can be written to the index directly */
+  const size_t old_count = ptr->matches.count;
+  size_t ranked[XCMD_RANKS] = { 0 };
+  xcmd_scan_items(ptr, ptr->matches.index, count, budget, ranked);
+  stats_count(dstats_matches, ptr->matches.count - old_count);
 
-  if(relative) {
-    const long yz = (long)ptr->matches.count;
-    const long dx = clip(offset, -yz, +yz);
-    const long dn = (0 <= offset) ? 0 : ptr->matches.count;
-    const long ds = dn + dx;
-    assert(0 <= ds);
+  const int pending = (ptr->items.count != ptr->matches.scanned);
 
-    ptr->matches.selected += ds;
-    ptr->matches.selected %= ptr->matches.count;
+  if(!pending) {
+    xcmd_cache_insert(ptr);
+    xcmd_stop_matching(ptr);
+  } /* if ... */
 
-  } else {
-    /* Select absolute element */
-    const size_t hi = ptr->matches.count;
-    ptr->matches.selected = clip(offset, 0, hi - (hi ? 1 : 0));
+  /* Notify observer, as more matches are known */
+  if(old_count != ptr->matches.count) {
+    ptr->matches.generation += 1;
+    ptr->has_changed = 1;
   } /* if ... */
 
-  /* Notify observer, as the model has changed */
-  ptr->has_changed |= (old_selected_item != ptr->matches.selected);
+  trace("matches", ptr->matches.scanned, ptr->matches.count, ptr->matches.generation);
+  trace_end("xcmd_continue_matching");
   xcmd_notify_observer(ptr);
 
-  return 0;
+  return pending;
 }
 
-int xcmd_auto_complete(xcmd_t *ptr)
+/* Store the ranks of n items, using match_batch if available */
+void xcmd_match_items(xcmd_t *ptr, char *const *items, size_t n, guint8 *ranks)
 {
-  assert(ptr);
+  if(ptr->match_batch) {
+    ptr->match_batch(ptr, items, n, ranks);
+    return;
+  } /* if ... */
+
+  /* Custom matchers are called per item */
+  size_t i;
+  for(i = 0; i < n; i += 1) {
+    size_t len = 0;
+    const char *text = xcmd_item_field(ptr, *(items + i), xcmd_field_match, &len);
+    const int rank = ptr->match(ptr, ptr->matches.input, text, len, ptr->match_data);
+    *(ranks + i) = clip(rank, 0, XCMD_RANKS - 1);
+  } /* for ... */
+}
+
+/* Append the item at position in items.index to matches, if it has a rank */
+void xcmd_add_match(xcmd_t *ptr, char **matches, guint32 position, int rank, size_t *ranked)
+{
+  /* If item doesn't match the input, go to the next one. */
+  if(!rank) return;
+
+  const guint8 r = clip(rank, 1, XCMD_RANKS - 1);
+  *(ptr->matches.ranks + ptr->matches.count) = r;
+  *(ptr->matches.positions + ptr->matches.count) = position;
+  *(matches + ptr->matches.count) = *(ptr->items.index + position);
+  ptr->matches.count += 1;
+  ranked[r] += 1;
+}
+
+/* Scan items for the input starting at matches.scanned in batches, until
+ * there are at least count matches or budget items have been scanned */
+void xcmd_scan_items(xcmd_t *ptr, char **matches, size_t count, size_t budget, size_t *ranked)
+{
+  assert(ptr);
+  assert(matches);
+  assert(ranked);
+
+  guint8 batch[XCMD_BATCH];
+  size_t position = ptr->matches.scanned;
+  const size_t end = ptr->matches.scanned + min(budget, ptr->items.count - ptr->matches.scanned);
+
+  while((end != position) && (ptr->matches.count < count)) {
+    const size_t n = min(end - position, XCMD_BATCH);
+    size_t i;
+
+    /* All matches of a batch are kept, even beyond count */
+    xcmd_match_items(ptr, ptr->items.index + position, n, batch);
+
+    for(i = 0; i < n; i += 1) {
+      xcmd_add_match(ptr, matches, position + i, *(batch + i), ranked);
+    } /* for ... */
+
+    position += n;
+  } /* while ... */
+
+  stats_count(dstats_items_scanned, position - ptr->matches.scanned);
+  ptr->matches.scanned = position;
+}
+
+/* Scan only the items at the positions of candidates into shadow */
+void xcmd_scan_candidates(xcmd_t *ptr, const dbitmap_t *candidates, size_t *ranked)
+{
+  assert(ptr);
+  assert(candidates);
+  assert(ranked);
+
+  guint8 batch[XCMD_BATCH];
+  guint32 positions[XCMD_BATCH];
+  char *items[XCMD_BATCH];
+  size_t n = 0;
+  int more = 1;
+  dbiter_t iter;
+  bitmap_iter_init(&iter, candidates);
+
+  /* Candidates are gathered into batches */
+  while(more) {
+    more = bitmap_iter_next(&iter, positions + n);
+    if(more) {
+      *(items + n) = *(ptr->items.index + *(positions + n));
+      n += 1;
+    } /* if ... */
+
+    if(n && (!more || (XCMD_BATCH == n))) {
+      size_t i;
+      xcmd_match_items(ptr, items, n, batch);
+
+      for(i = 0; i < n; i += 1) {
+        xcmd_add_match(ptr, ptr->matches.shadow, *(positions + i), *(batch + i), ranked);
+      } /* for ... */
+
+      n = 0;
+    } /* if ... */
+  } /* while ... */
+
+  stats_count(dstats_items_scanned, candidates->cardinality);
+  ptr->matches.scanned = ptr->items.count;
+}
+
+/* Distribute matches into buckets by rank in a single stable pass */
+void xcmd_rank_matches(xcmd_t *ptr, const size_t *ranked)
+{
+  assert(ptr);
+  assert(ranked);
+
+  if(ptr->matches.count == ranked[1]) return;
+
+  size_t offset[XCMD_RANKS] = { 0 };
+  size_t r, i;
+
+  for(r = 2; r < XCMD_RANKS; r += 1) offset[r] = offset[r - 1] + ranked[r - 1];
+
+  for(i = 0; i < ptr->matches.count; i += 1) {
+    r = *(ptr->matches.ranks + i);
+    *(ptr->matches.buckets + offset[r]) = *(ptr->matches.shadow + i);
+    offset[r] += 1;
+  } /* for ... */
+
+  char **tmp = ptr->matches.shadow;
+  ptr->matches.shadow = ptr->matches.buckets;
+  ptr->matches.buckets = tmp;
+}
+
+/* Release the match data once scanning is complete or abandoned */
+void xcmd_stop_matching(xcmd_t *ptr)
+{
+  assert(ptr);
+
+  if(ptr->match_free && ptr->match_data) ptr->match_free(ptr, ptr->match_data);
+  ptr->match_data = NULL;
+  ptr->matches.scanned = ptr->items.count;
+}
+
+/* Move entry to the front of the least recently used list */
+void xcmd_cache_touch(xcmd_t *ptr, xcentry_t *entry)
+{
+  if(ptr->cache.first == entry) return;
+
+  /* Unlink */
+  entry->prev->next = entry->next;
+  if(entry->next) entry->next->prev = entry->prev;
+  else ptr->cache.last = entry->prev;
+
+  /* Insert at front */
+  entry->prev = NULL;
+  entry->next = ptr->cache.first;
+  ptr->cache.first->prev = entry;
+  ptr->cache.first = entry;
+}
+
+/* Find the match set of input */
+xcentry_t *xcmd_cache_lookup(xcmd_t *ptr, const char *input)
+{
+  assert(ptr);
+  assert(input);
+
+  if(!ptr->cache.entries) return NULL;
+
+  xcentry_t *entry = (xcentry_t*)g_hash_table_lookup(ptr->cache.entries, input);
+  if(entry) xcmd_cache_touch(ptr, entry);
+
+  return entry;
+}
+
+/* Find the match set of the longest proper prefix of input */
+xcentry_t *xcmd_cache_lookup_prefix(xcmd_t *ptr, const char *input)
+{
+  assert(ptr);
+  assert(input);
+
+  if(!ptr->cache.entries || !ptr->cache.first) return NULL;
+
+  char *prefix = xstrdup(input);
+  size_t n = strlen(prefix);
+  xcentry_t *entry = NULL;
+
+  while(!entry && (1 < n)) {
+    n -= 1;
+    *(prefix + n) = '\0';
+    entry = xcmd_cache_lookup(ptr, prefix);
+  } /* while ... */
+
+  free(prefix);
+  return entry;
+}
+
+/* Write the matches of entry into shadow in order of position */
+void xcmd_cache_restore(xcmd_t *ptr, const xcentry_t *entry, size_t *ranked)
+{
+  assert(ptr);
+  assert(entry);
+  assert(ranked);
+
+  dbiter_t iter;
+  guint32 position;
+  ptr->matches.count = 0;
+  bitmap_iter_init(&iter, &entry->matches);
+
+  while(bitmap_iter_next(&iter, &position)) {
+    const guint8 r = entry->ranks ? *(entry->ranks + ptr->matches.count) : 1;
+    *(ptr->matches.shadow + ptr->matches.count) = *(ptr->items.index + position);
+    *(ptr->matches.ranks + ptr->matches.count) = r;
+    *(ptr->matches.positions + ptr->matches.count) = position;
+    ptr->matches.count += 1;
+    ranked[r] += 1;
+  } /* while ... */
+
+  ptr->matches.scanned = ptr->items.count;
+}
+
+/* Store the matches of matches.input, once all items have been scanned */
+void xcmd_cache_insert(xcmd_t *ptr)
+{
+  assert(ptr);
+
+  if(!ptr->cache.entries || !ptr->matches.input) return;
+  if(g_hash_table_lookup(ptr->cache.entries, ptr->matches.input)) return;
+
+  xcentry_t *entry = (xcentry_t*)xmalloc(sizeof(xcentry_t));
+  size_t i;
+
+  bitmap_init(&entry->matches);
+  for(i = 0; i < ptr->matches.count; i += 1) {
+    bitmap_append(&entry->matches, *(ptr->matches.positions + i));
+  } /* for ... */
+
+  entry->ranks = NULL;
+  if(ptr->match_ranked && ptr->matches.count) {
+    entry->ranks = (guint8*)xmalloc(ptr->matches.count * sizeof(guint8));
+    memcpy(entry->ranks, ptr->matches.ranks, ptr->matches.count * sizeof(guint8));
+  } /* if ... */
+
+  entry->input = xstrdup(ptr->matches.input);
+  entry->size = sizeof(xcentry_t) + strlen(entry->input) + 1 + entry->matches.size
+      + (entry->ranks ? ptr->matches.count * sizeof(guint8) : 0);
+
+  /* Entries never exceed the capacity */
+  if(entry->size > ptr->cache.capacity) {
+    debug("Match set of `%s' exceeds cache.", entry->input);
+    bitmap_destroy(&entry->matches);
+    free(entry->ranks);
+    free(entry->input);
+    free(entry);
+    return;
+  } /* if ... */
+
+  xcmd_cache_evict(ptr, ptr->cache.capacity - entry->size);
+
+  entry->prev = NULL;
+  entry->next = ptr->cache.first;
+  if(ptr->cache.first) ptr->cache.first->prev = entry;
+  else ptr->cache.last = entry;
+  ptr->cache.first = entry;
+  ptr->cache.size += entry->size;
+  g_hash_table_insert(ptr->cache.entries, entry->input, entry);
+}
+
+/* Drop least recently used entries, until at most capacity bytes are used */
+void xcmd_cache_evict(xcmd_t *ptr, size_t capacity)
+{
+  assert(ptr);
+
+  while(ptr->cache.last && (ptr->cache.size > capacity)) {
+    xcentry_t *entry = ptr->cache.last;
+    debug("Evict match set of `%s' from cache.", entry->input);
+
+    ptr->cache.last = entry->prev;
+    if(ptr->cache.last) ptr->cache.last->next = NULL;
+    else ptr->cache.first = NULL;
+
+    g_hash_table_remove(ptr->cache.entries, entry->input);
+    ptr->cache.size -= entry->size;
+    bitmap_destroy(&entry->matches);
+    free(entry->ranks);
+    free(entry->input);
+    free(entry);
+  } /* while ... */
+}
+
+int xcmd_update_selected(xcmd_t *ptr, const long offset, const int relative)
+{
+  assert(ptr);
+  debug("Update selected item.");
+
+  /* An offset of 0 doesn't change anything */
+  if(!offset && relative) return 0;
+
+  /* Scan on demand, so the new selection and the page following it are known.
+   * Moving backwards past the first item wraps around to the last one. */
+  if(ptr->items.count != ptr->matches.scanned) {
+    const long target = relative ? (long)ptr->matches.selected + offset : offset;
+    const size_t count = (0 <= target) ? (size_t)target + 1 + ptr->matches.page : (relative ? G_MAXSIZE : 0);
+    xcmd_continue_matching(ptr, count, G_MAXSIZE);
+  } /* if ... */
+
+  /* No data */
+  if(!ptr->matches.count) return 0;
+
+  const size_t old_selected_item = ptr->matches.selected;
+
+  if(relative) {
+    const long yz = (long)ptr->matches.count;
+    const long dx = clip(offset, -yz, +yz);
+    const long dn = (0 <= offset) ? 0 : ptr->matches.count;
+    const long ds = dn + dx;
+    assert(0 <= ds);
+
+    ptr->matches.selected += ds;
+    ptr->matches.selected %= ptr->matches.count;
+
+  } else {
+    /* Select absolute element */
+    const size_t hi = ptr->matches.count;
+    ptr->matches.selected = clip(offset, 0, hi - (hi ? 1 : 0));
+  } /* if ... */
+
+  /* Notify observer, as the model has changed */
+  ptr->has_changed |= (old_selected_item != ptr->matches.selected);
+  xcmd_notify_observer(ptr);
+
+  return 0;
+}
+
+int xcmd_auto_complete(xcmd_t *ptr)
+{
+  assert(ptr);
+
+  /* Complete on all matches */
+  xcmd_continue_matching(ptr, G_MAXSIZE, G_MAXSIZE);
 
   /* No data --> No auto-complete */
   if(!ptr->matches.count) return 0;
@@ -339,20 +1561,29 @@ int xcmd_auto_complete(xcmd_t *ptr)
    */
   debug("Run auto-complete.");
 
+  const gint64 begin = stats_now();
 
+  /* Complete on the match field, as this is what input is matched against */
   char **it = ptr->matches.index;
   char **const end = ptr->matches.index + ptr->matches.count;
-  GString *str = g_string_overwrite(ptr->matches.complete, 0, *it);
+  size_t n = 0;
+  const char *text = xcmd_item_field(ptr, *it, xcmd_field_match, &n);
+  GString *str = g_string_truncate(ptr->matches.complete, 0);
+  str = g_string_append_len(str, text, n);
   it += 1;
 
   while(end != it) {
-    while(str->len && (*ptr->strncmp)(str->str, *it, str->len)) {
-      debug("Complete? `%s' -- `%s'", str->str, *it);
+    text = xcmd_item_field(ptr, *it, xcmd_field_match, &n);
+
+    while(str->len && ((n < str->len) || (*ptr->strncmp)(str->str, text, str->len))) {
+      debug("Complete? `%s' -- `%.*s'", str->str, (int)n, text);
       str = g_string_truncate(str, str->len - 1);
     } /* while ... */
     it += 1;
   }
 
+  stats_record(dstats_complete, begin);
+
   if(str->len) {
     ptr->matches.input = str->str;
     return 1;
@@ -380,31 +1611,342 @@ int xcmd_notify_observer(xcmd_t *ptr)
   return 0;
 }
 
+/* Fields */
+int xcmd_parse_fields(const char *spec, unsigned int *first, unsigned int *last)
+{
+  assert(first);
+  assert(last);
+
+  /* Select whole item */
+  *first = 0;
+  *last = 0;
+  if(!spec) return 0;
+
+  char *end = NULL;
+  *first = strtoul(spec, &end, 10);
+  if((spec == end) || !*first) return -1;
+
+  if('\0' == *end) {
+    /* Single field: N */
+    *last = *first;
+
+  } else if('-' == *end) {
+    /* Range of fields: N-M or N- */
+    spec = end + 1;
+    if('\0' == *spec) return 0;
+
+    *last = strtoul(spec, &end, 10);
+    if((spec == end) || ('\0' != *end) || (*last < *first)) return -1;
+
+  } else {
+    return -1;
+
+  } /* if ... */
+
+  return 0;
+}
+
+void xcmd_find_fields(const xcmd_t *ptr, const char *item, size_t n, xspan_t *spans)
+{
+  assert(ptr);
+  assert(item);
+  assert(spans);
+
+  xfield_t field;
+
+  for(field = 0; field < xcmd_field_count; field += 1) {
+    const unsigned int first = ptr->fields.first[field];
+    const unsigned int last = ptr->fields.last[field];
+
+    /* Missing fields result in an empty range at the end of the item */
+    size_t begin = first ? n : 0;
+    size_t end = n;
+    size_t start = 0;
+    unsigned int number = 1;
+    size_t i;
+
+    for(i = 0; first && (i <= n); i += 1) {
+      /* Find end of current field */
+      if((i < n) && (ptr->fields.delimiter != item[i])) continue;
+
+      if(number == first) begin = start;
+      if(number == last) {
+        end = i;
+        break;
+      } /* if ... */
+
+      number += 1;
+      start = i + 1;
+    } /* for ... */
+
+    spans[field].offset = begin;
+    spans[field].length = end - begin;
+  } /* for ... */
+}
+
+/* Sort */
+static int xcmd_compare_bytes(const char *a, size_t n, const char *b, size_t m)
+{
+  const int result = memcmp(a, b, min(n, m));
+  if(result) return result;
+
+  return (n > m) - (n < m);
+}
+
+static int xcmd_compare_natural(const char *a, size_t n, const char *b, size_t m)
+{
+  const char *const a_end = a + n;
+  const char *const b_end = b + m;
+
+  while((a_end != a) && (b_end != b)) {
+    if(isdigit((unsigned char)*a) && isdigit((unsigned char)*b)) {
+      /* Compare runs of digits by their value, ignoring leading zeros */
+      while((a_end != a) && ('0' == *a)) a += 1;
+      while((b_end != b) && ('0' == *b)) b += 1;
+
+      const char *x = a, *y = b;
+      while((a_end != x) && isdigit((unsigned char)*x)) x += 1;
+      while((b_end != y) && isdigit((unsigned char)*y)) y += 1;
+
+      /* Longer runs have larger values */
+      if((x - a) != (y - b)) return ((x - a) > (y - b)) ? 1 : -1;
+
+      const int result = memcmp(a, b, x - a);
+      if(result) return result;
+
+      a = x;
+      b = y;
+      continue;
+    } /* if ... */
+
+    if(*a != *b) return (unsigned char)*a - (unsigned char)*b;
+    a += 1;
+    b += 1;
+  } /* while ... */
+
+  return (a_end != a) - (b_end != b);
+}
+
+static gint xcmd_compare_items(gconstpointer a, gconstpointer b, gpointer data)
+{
+  const xsortjob_t *job = (const xsortjob_t*)data;
+  const char *x = *(const char**)a;
+  const char *y = *(const char**)b;
+  size_t n = 0, m = 0;
+  int result = 0;
+
+  const char *s = xcmd_item_field(job->model, x, xcmd_field_display, &n);
+  const char *t = xcmd_item_field(job->model, y, xcmd_field_display, &m);
+
+  switch(job->model->items.sort) {
+    case xcmd_sort_length:
+      result = (n > m) - (n < m);
+      if(!result) result = xcmd_compare_bytes(s, n, t, m);
+      break;
+
+    case xcmd_sort_natural:
+      result = xcmd_compare_natural(s, n, t, m);
+      break;
+
+    case xcmd_sort_locale:
+      result = strcmp(job->keys[xcmd_item_id(x)], job->keys[xcmd_item_id(y)]);
+      break;
+
+    case xcmd_sort_lex:
+    case xcmd_sort_none:
+      result = xcmd_compare_bytes(s, n, t, m);
+      break;
+  } /* switch ... */
+
+  /* Keep order of input on equal items */
+  if(!result) result = (xcmd_item_id(x) > xcmd_item_id(y)) - (xcmd_item_id(x) < xcmd_item_id(y));
+  return result;
+}
+
+static gpointer xcmd_sort_worker(gpointer data)
+{
+  xsortjob_t *job = (xsortjob_t*)data;
+  assert(job);
+
+  if(job->merge) {
+    /* Merge both runs into buffer */
+    char **x = job->items, **const x_end = job->items + job->n;
+    char **y = x_end, **const y_end = x_end + job->m;
+    char **out = job->buffer;
+
+    while((x_end != x) && (y_end != y)) {
+      if(0 < xcmd_compare_items(x, y, job)) *(out++) = *(y++);
+      else *(out++) = *(x++);
+    } /* while ... */
+
+    memcpy(out, x, (x_end - x) * sizeof(char*));
+    out += x_end - x;
+    memcpy(out, y, (y_end - y) * sizeof(char*));
+    return NULL;
+  } /* if ... */
+
+  /* Collation keys are computed by the run owning the item */
+  if(job->keys) {
+    char **it;
+    char **const end = job->items + job->n;
+
+    for(it = job->items; end != it; it += 1) {
+      size_t n = 0;
+      const char *text = xcmd_item_field(job->model, *it, xcmd_field_display, &n);
+      gchar *copy = g_strndup(text, n);
+      const size_t size = strxfrm(NULL, copy, 0) + 1;
+      char *key = (char*)xmalloc(size);
+      strxfrm(key, copy, size);
+      job->keys[xcmd_item_id(*it)] = key;
+      g_free(copy);
+    } /* for ... */
+  } /* if ... */
+
+  g_qsort_with_data(job->items, job->n, sizeof(char*), xcmd_compare_items, job);
+  return NULL;
+}
+
+/* Run jobs in parallel; this thread runs the first job */
+static void xcmd_sort_run(xsortjob_t *jobs, guint n_jobs, GThread **threads)
+{
+  guint i;
+
+  for(i = 1; i < n_jobs; i += 1) {
+    threads[i] = g_thread_new("sort", xcmd_sort_worker, jobs + i);
+  } /* for ... */
+
+  xcmd_sort_worker(jobs);
+
+  for(i = 1; i < n_jobs; i += 1) {
+    g_thread_join(threads[i]);
+  } /* for ... */
+}
+
+void xcmd_sort_items(xcmd_t *ptr)
+{
+  assert(ptr);
+
+  const size_t count = ptr->items.count;
+  const guint n_runs = max(1, min(g_get_num_processors(), count / sort_run_min));
+  debug("Sort %lu items in %u runs.", count, n_runs);
+  trace_begin("xcmd_sort_items");
+
+  xsortjob_t *jobs = (xsortjob_t*)xmalloc(n_runs * sizeof(xsortjob_t));
+  GThread **threads = (GThread**)xmalloc(n_runs * sizeof(GThread*));
+  char **keys = NULL;
+  char **src = ptr->items.index;
+  char **dst = (char**)xmalloc(count * sizeof(char*));
+  guint i, width, n_jobs;
+
+  if(xcmd_sort_locale == ptr->items.sort) keys = (char**)xmalloc(count * sizeof(char*));
+
+  /* Sort runs of nearly equal size */
+  for(i = 0; i < n_runs; i += 1) {
+    const size_t begin = i * count / n_runs;
+    const size_t end = (i + 1) * count / n_runs;
+    const xsortjob_t job = { .model = ptr, .keys = keys, .items = src + begin, .buffer = NULL, .n = end - begin, .m = 0, .merge = 0 };
+    jobs[i] = job;
+  } /* for ... */
+
+  xcmd_sort_run(jobs, n_runs, threads);
+
+  /* Merge pairs of adjacent runs, until there is a single run */
+  for(width = 1; width < n_runs; width *= 2) {
+    n_jobs = 0;
+
+    for(i = 0; i < n_runs; i += 2 * width) {
+      const size_t begin = i * count / n_runs;
+      const size_t middle = min(i + width, n_runs) * count / n_runs;
+      const size_t end = min(i + 2 * width, n_runs) * count / n_runs;
+      const xsortjob_t job = { .model = ptr, .keys = keys, .items = src + begin, .buffer = dst + begin, .n = middle - begin, .m = end - middle, .merge = 1 };
+      jobs[n_jobs++] = job;
+    } /* for ... */
+
+    xcmd_sort_run(jobs, n_jobs, threads);
+
+    char **tmp = src;
+    src = dst;
+    dst = tmp;
+  } /* for ... */
+
+  /* Sorted items may have ended up in the buffer */
+  if(src != ptr->items.index) {
+    free(ptr->items.index);
+    ptr->items.index = src;
+    ptr->items.allocated = count;
+  } else {
+    free(dst);
+  } /* if ... */
+
+  if(keys) {
+    size_t k;
+    for(k = 0; k < count; k += 1) free(keys[k]);
+    free(keys);
+  } /* if ... */
+
+  free(threads);
+  free(jobs);
+  trace_end("xcmd_sort_items");
+}
+
+/* Generate a batch match function. The input is prepared once per batch and
+ * every item is matched by the inline function item, which additionally gets
+ * the length of the input. */
+#define XCMD_MATCH_BATCH(name, prepare, item) \
+void name(const xcmd_t *ptr, char *const *items, size_t n, guint8 *ranks) \
+{ \
+  assert(ptr); \
+  assert(items); \
+  assert(ranks); \
+  trace(#name, n, 0, 0); \
+ \
+  const char *input = prepare(ptr->matches.input); \
+  const size_t input_size = strlen(input); \
+  const void *data = ptr->match_data; \
+  size_t i; \
+ \
+  for(i = 0; i < n; i += 1) { \
+    size_t len = 0; \
+    const char *text = xcmd_item_field(ptr, *(items + i), xcmd_field_match, &len); \
+    const int rank = item(ptr, input, input_size, text, len, data); \
+    *(ranks + i) = clip(rank, 0, XCMD_RANKS - 1); \
+  } /* for ... */ \
+}
+
+static inline const char *xcmd_keep_input(const char *input)
+{
+  return input;
+}
+
+static inline const char *xcmd_strip_input(const char *input)
+{
+  while(('\0' != *input) && isspace(*input)) input += 1;
+  return input;
+}
+
 /* Match: Prefix */
-int match_prefix(const xcmd_t *ptr, const char *input, const char *text, const void *data)
+int match_prefix(const xcmd_t *ptr, const char *input, const char *text, size_t n, const void *data)
 {
   assert(ptr);
   assert(input);
   assert(text);
   assert(ptr->strncmp);
-  debug("Match input ˋ%s' against text ˋ%s'.", input, text);
+  trace("match_prefix", n, 0, 0);
 
-  /* Get minimum length of input and text */
   const size_t input_size = strlen(input);
-  const size_t text_size = strlen(text);
 
   /* This is the case, when input is no longer a prefix of text */
-  if(text_size < input_size) return 0;
+  if(n < input_size) return 0;
 
   return !(*ptr->strncmp)(input, text, input_size);
 }
 
-int match_strip_prefix(const xcmd_t *ptr, const char *input, const char *text, const void *data)
+int match_strip_prefix(const xcmd_t *ptr, const char *input, const char *text, size_t n, const void *data)
 {
   assert(ptr);
   assert(input);
   assert(text);
-  debug("Match stripped input ˋ%s' against text ˋ%s'.", input, text);
+  trace("match_strip_prefix", n, 0, 0);
 
   /* Strip leading white space characters of input */
   while(('\0' != *input) && isspace(*input)) {
@@ -412,15 +1954,53 @@ int match_strip_prefix(const xcmd_t *ptr, const char *input, const char *text, c
   } /* while ... */
 
   /* Strip leading white space characters of text */
-  while(('\0' != *text) && isspace(*text)) {
+  while(n && isspace(*text)) {
+    text += 1;
+    n -= 1;
+  } /* while ... */
+
+  return match_prefix(ptr, input, text, n, data);
+}
+
+/* The input contains no NUL-byte, so comparing it bytewise is equivalent to
+ * strncmp */
+static inline int xcmd_prefix_case(const xcmd_t *ptr, const char *input, size_t input_size, const char *text, size_t n, const void *data)
+{
+  return (input_size <= n) && !memcmp(input, text, input_size);
+}
+
+static inline int xcmd_prefix_icase(const xcmd_t *ptr, const char *input, size_t input_size, const char *text, size_t n, const void *data)
+{
+  return (input_size <= n) && !strncasecmp(input, text, input_size);
+}
+
+static inline int xcmd_strip_prefix_case(const xcmd_t *ptr, const char *input, size_t input_size, const char *text, size_t n, const void *data)
+{
+  while(n && isspace(*text)) {
+    text += 1;
+    n -= 1;
+  } /* while ... */
+
+  return xcmd_prefix_case(ptr, input, input_size, text, n, data);
+}
+
+static inline int xcmd_strip_prefix_icase(const xcmd_t *ptr, const char *input, size_t input_size, const char *text, size_t n, const void *data)
+{
+  while(n && isspace(*text)) {
     text += 1;
+    n -= 1;
   } /* while ... */
 
-  return match_prefix(ptr, input, text, data);
+  return xcmd_prefix_icase(ptr, input, input_size, text, n, data);
 }
 
+XCMD_MATCH_BATCH(match_prefix_batch_case, xcmd_keep_input, xcmd_prefix_case)
+XCMD_MATCH_BATCH(match_prefix_batch_icase, xcmd_keep_input, xcmd_prefix_icase)
+XCMD_MATCH_BATCH(match_strip_prefix_batch_case, xcmd_strip_input, xcmd_strip_prefix_case)
+XCMD_MATCH_BATCH(match_strip_prefix_batch_icase, xcmd_strip_input, xcmd_strip_prefix_icase)
+
 /* Match: Regex */
-int match_regex(const xcmd_t *ptr, const char *input, const char *text, const void *data)
+int match_regex(const xcmd_t *ptr, const char *input, const char *text, size_t n, const void *data)
 {
   assert(ptr);
   assert(input);
@@ -429,10 +2009,19 @@ int match_regex(const xcmd_t *ptr, const char *input, const char *text, const vo
   /* Check for regular expression */
   if(!data) return 0;
 
+  /* Only match within the field, which isn't NUL-terminated */
   const regex_t *reg = (const regex_t*)data;
-  return (REG_NOMATCH != regexec(reg, text, 0, NULL, 0));
+  regmatch_t range = { .rm_so = 0, .rm_eo = n };
+  return (REG_NOMATCH != regexec(reg, text, 1, &range, REG_STARTEND));
 }
 
+static inline int xcmd_regex_item(const xcmd_t *ptr, const char *input, size_t input_size, const char *text, size_t n, const void *data)
+{
+  return match_regex(ptr, input, text, n, data);
+}
+
+XCMD_MATCH_BATCH(match_regex_batch, xcmd_keep_input, xcmd_regex_item)
+
 void *match_regex_initx(xcmd_t *ptr, const char *input, const int flags)
 {
   assert(ptr);
@@ -468,6 +2057,233 @@ void match_regex_free(const xcmd_t *ptr, void *data)
   free(data);
 }
 
+/* Match: GRegex */
+int match_gregex(const xcmd_t *ptr, const char *input, const char *text, size_t n, const void *data)
+{
+  assert(ptr);
+  assert(input);
+  assert(text);
+
+  /* Check for regular expression */
+  if(!data) return 0;
+
+  /* The length is known, so the field needn't be NUL-terminated */
+  return g_regex_match_full((const GRegex*)data, text, n, 0, 0, NULL, NULL);
+}
+
+static inline int xcmd_gregex_item(const xcmd_t *ptr, const char *input, size_t input_size, const char *text, size_t n, const void *data)
+{
+  return match_gregex(ptr, input, text, n, data);
+}
+
+XCMD_MATCH_BATCH(match_gregex_batch, xcmd_keep_input, xcmd_gregex_item)
+
+void *match_gregex_initx(xcmd_t *ptr, const char *input, const GRegexCompileFlags flags)
+{
+  assert(ptr);
+  assert(input);
+
+  /* Compile once per input; matches are never captured */
+  GError *error = NULL;
+  GRegex *regex = g_regex_new(input, G_REGEX_OPTIMIZE | G_REGEX_NO_AUTO_CAPTURE | flags, 0, &error);
+
+  if(!regex) {
+    /* `g_regex_new' failed */
+    debug("Cannot compile regular expression: %s", error->message);
+    g_error_free(error);
+    ptr->match_ok = 0;
+    return NULL;
+  } /* if ... */
+
+  ptr->match_ok = 1;
+  return regex;
+}
+
+void *match_gregex_init_case(xcmd_t *ptr, const char *input)
+{
+  return match_gregex_initx(ptr, input, 0);
+}
+
+void *match_gregex_init_icase(xcmd_t *ptr, const char *input)
+{
+  return match_gregex_initx(ptr, input, G_REGEX_CASELESS);
+}
+
+void match_gregex_free(const xcmd_t *ptr, void *data)
+{
+  assert(ptr);
+  if(data) g_regex_unref((GRegex*)data);
+}
+
+/* Match: Tokens */
+typedef struct
+{
+  /* Transitions of the automaton, 256 per state */
+  guint32 *delta;
+  /* Tokens found on entering a state, one bit per token */
+  guint64 *found;
+  /* Bits of all tokens */
+  guint64 all;
+  /* Bytes are mapped before lookup, e.g. to fold their case */
+  unsigned char fold[256];
+  /* First token and length of input for ranking */
+  const char *first;
+  size_t first_length;
+  size_t length;
+} xtokens_t;
+
+int match_tokens(const xcmd_t *ptr, const char *input, const char *text, size_t n, const void *data)
+{
+  assert(ptr);
+  assert(input);
+  assert(text);
+
+  if(!data) return 0;
+
+  /* Scan item once for all tokens */
+  const xtokens_t *ac = (const xtokens_t*)data;
+  const unsigned char *it = (const unsigned char*)text;
+  const unsigned char *const end = it + n;
+  guint64 found = 0;
+  guint32 state = 0;
+
+  for(; (end != it) && (ac->all != found); it += 1) {
+    state = *(ac->delta + (state << 8) + ac->fold[*it]);
+    found |= *(ac->found + state);
+  } /* for ... */
+
+  if(ac->all != found) return 0;
+
+  /* Items starting with the whole input go first, then those starting with the
+   * first token, then all others */
+  if(!ac->all) return 1;
+  if((ac->length <= n) && !ptr->strncmp(input, text, ac->length)) return 1;
+  if((ac->first_length <= n) && !ptr->strncmp(ac->first, text, ac->first_length)) return 2;
+  return 3;
+}
+
+static inline int xcmd_tokens_item(const xcmd_t *ptr, const char *input, size_t input_size, const char *text, size_t n, const void *data)
+{
+  return match_tokens(ptr, input, text, n, data);
+}
+
+XCMD_MATCH_BATCH(match_tokens_batch, xcmd_keep_input, xcmd_tokens_item)
+
+void *match_tokens_initx(xcmd_t *ptr, const char *input, const int icase)
+{
+  assert(ptr);
+  assert(input);
+
+  /* The trie has at most one state per byte of input and the root */
+  const size_t length = strlen(input);
+  const size_t max_states = length + 1;
+  xtokens_t *ac = (xtokens_t*)xmalloc(sizeof(xtokens_t));
+  ac->delta = (guint32*)xmalloc(max_states * 256 * sizeof(guint32));
+  ac->found = (guint64*)xmalloc(max_states * sizeof(guint64));
+  ac->first = input;
+  ac->first_length = 0;
+  ac->length = length;
+  memset(ac->delta, 0, max_states * 256 * sizeof(guint32));
+  memset(ac->found, 0, max_states * sizeof(guint64));
+
+  size_t c;
+  for(c = 0; c < 256; c += 1) ac->fold[c] = icase ? tolower(c) : c;
+
+  /* Insert tokens separated by spaces into the trie */
+  const char *it = input;
+  guint32 n_states = 1;
+  unsigned int n_tokens = 0;
+
+  while(*it) {
+    if(' ' == *it) {
+      it += 1;
+      continue;
+    } /* if ... */
+
+    if(64 == n_tokens) {
+      /* Tokens are tracked by the bits of a guint64 */
+      match_tokens_free(ptr, ac);
+      ptr->match_ok = 0;
+      return NULL;
+    } /* if ... */
+
+    if(!n_tokens) ac->first = it;
+
+    guint32 state = 0;
+    for(; *it && (' ' != *it); it += 1) {
+      guint32 *next = ac->delta + (state << 8) + ac->fold[(unsigned char)*it];
+      /* The root is never entered again, so zero marks missing transitions */
+      if(!*next) *next = n_states++;
+      state = *next;
+    } /* for ... */
+
+    if(!n_tokens) ac->first_length = it - ac->first;
+    *(ac->found + state) |= (guint64)1 << n_tokens;
+    n_tokens += 1;
+  } /* while ... */
+
+  ac->all = (64 == n_tokens) ? ~(guint64)0 : ((guint64)1 << n_tokens) - 1;
+
+  /* Complete transitions breadth first using the failure links */
+  guint32 *fail = (guint32*)xmalloc(n_states * sizeof(guint32));
+  guint32 *queue = (guint32*)xmalloc(n_states * sizeof(guint32));
+  size_t head = 0, tail = 0;
+
+  for(c = 0; c < 256; c += 1) {
+    const guint32 next = *(ac->delta + c);
+    if(!next) continue;
+
+    *(fail + next) = 0;
+    *(queue + tail++) = next;
+  } /* for ... */
+
+  while(head != tail) {
+    const guint32 state = *(queue + head++);
+    const guint32 *fallback = ac->delta + (*(fail + state) << 8);
+    guint32 *delta = ac->delta + (state << 8);
+
+    /* Tokens ending in the failure state end here, too */
+    *(ac->found + state) |= *(ac->found + *(fail + state));
+
+    for(c = 0; c < 256; c += 1) {
+      if(*(delta + c)) {
+        *(fail + *(delta + c)) = *(fallback + c);
+        *(queue + tail++) = *(delta + c);
+      } else {
+        *(delta + c) = *(fallback + c);
+      } /* if ... */
+    } /* for ... */
+  } /* while ... */
+
+  free(queue);
+  free(fail);
+
+  ptr->match_ok = 1;
+  return ac;
+}
+
+void *match_tokens_init_case(xcmd_t *ptr, const char *input)
+{
+  return match_tokens_initx(ptr, input, 0);
+}
+
+void *match_tokens_init_icase(xcmd_t *ptr, const char *input)
+{
+  return match_tokens_initx(ptr, input, 1);
+}
+
+void match_tokens_free(const xcmd_t *ptr, void *data)
+{
+  assert(ptr);
+
+  xtokens_t *ac = (xtokens_t*)data;
+  if(!ac) return;
+
+  free(ac->delta);
+  free(ac->found);
+  free(ac);
+}
+
 /* Configuration */
 int xcmd_config_load(xcfg_t *ptr, FILE *f){assert(0); return 0;}
        
@@ -478,6 +2294,17 @@ int xcmd_config_default(xcfg_t *ptr)
   ptr->match = xcmd_match_prefix;
   ptr->complete = xcmd_complete_none;
   ptr->case_insensitive = 0;
+  ptr->delimiter = '\t';
+  ptr->fields[xcmd_field_display] = NULL;
+  ptr->fields[xcmd_field_match] = NULL;
+  ptr->fields[xcmd_field_output] = NULL;
+  ptr->print_index = 0;
+  ptr->print_source = 0;
+  ptr->unique = 0;
+  ptr->sort = xcmd_sort_none;
+  ptr->regex = xcmd_regex_posix;
+  ptr->page = 0;
+  ptr->cache = 8 * 1024 * 1024;
 
   return 0;
 }
@@ -7,6 +7,68 @@ typedef struct xcmd xcmd_t;
 typedef struct xcmd_config  xcfg_t;
 typedef enum xcmd_match     xmatch_t;
 typedef enum xcmd_complete  xcomplete_t;
+typedef enum xcmd_field     xfield_t;
+typedef enum xcmd_sort      xsort_t;
+typedef enum xcmd_regex     xregex_t;
+typedef struct xcmd_span    xspan_t;
+typedef struct xcmd_chunk   xchunk_t;
+typedef struct xcmd_cache_entry xcentry_t;
+
+/** \brief Number of ranks of matching items
+ *
+ * The \c match function returns the rank of matching items, starting at 1.
+ * Larger values are treated as the last rank.
+ */
+#define XCMD_RANKS 4
+
+/** \brief Fields of an item
+ *
+ * Items may consist of several fields separated by a delimiter. Different
+ * fields can be selected for displaying, matching and printing items.
+ */
+enum xcmd_field
+{
+  /** \brief Field displayed by the viewer */
+  xcmd_field_display,
+  /** \brief Field matched against the input */
+  xcmd_field_match,
+  /** \brief Field printed on selection */
+  xcmd_field_output,
+  /** \brief Number of field selections */
+  xcmd_field_count
+};
+
+/** \brief Byte range of a field
+ *
+ * The range is given relative to the start of the item it belongs to.
+ */
+struct xcmd_span
+{
+  guint32 offset;
+  guint32 length;
+};
+
+/** \brief Sort orders
+ *
+ * Items are sorted on their display field once by \c xcmd_finish_items.
+ * Items that compare equal keep their order of input.
+ */
+enum xcmd_sort
+{
+  /** \brief Keep items in order of input */
+  xcmd_sort_none,
+  /** \brief Sort items bytewise */
+  xcmd_sort_lex,
+  /** \brief Sort items bytewise, comparing runs of digits by their value */
+  xcmd_sort_natural,
+  /** \brief Sort items by their length, then bytewise */
+  xcmd_sort_length,
+  /** \brief Sort items using the collation of the current locale
+   *
+   * Collation keys are computed once per item using \c strxfrm.
+   */
+  xcmd_sort_locale
+};
 
 /** \brief Model container
  *
@@ -21,19 +83,81 @@ struct xcmd
   {
     /** \brief List of items
      *
-     * This list contains the start addresses of all strings in \c data.
+     * This list contains the start addresses of all strings in \c chunks. It
+     * grows while items are added, so the items read so far can be indexed
+     * before the input is complete.
      */
     char **index;
-    /** \brief Contingous string of all items
+    /** \brief Number of entries allocated for \c index */
+    size_t allocated;
+    /** \brief Arena of all items
+     *
+     * The items are stored in a list of chunks, that grow geometrically in
+     * size and are never moved, so pointers to items remain valid while
+     * further items are added. Single items are separated by a single
+     * NUL-byte. Every item is preceded by a header holding its id, i.e. its
+     * position in input, and its length. Use \c xcmd_item_id and \c
+     * xcmd_item_length to access the header.
+     */
+    xchunk_t *chunks;
+    /** \brief Chunk items are appended to */
+    xchunk_t *last;
+    /** \brief Number of bytes used in \c chunks */
+    size_t size;
+    /** \brief Number of bytes allocated for \c chunks */
+    size_t capacity;
+    /** \brief Set of items added so far
+     *
+     * If duplicates are dropped, this set is used to look up every new item
+     * before it is added. It is released by \c xcmd_finish_items.
+     */
+    GHashTable *unique;
+    /** \brief End of the items of every source
      *
-     * The string contains all items in a contigous way. Single items are
-     * separated by a single NUL-byte.
+     * If items are read from several streams by \c xcmd_read_streams, this
+     * array holds the number of items read up to and including each source.
+     * Sources are merged in order, so their items have consecutive ids. Use
+     * \c xcmd_item_source to get the source of an item. Otherwise this is \c
+     * NULL.
      */
-    char *data;
+    GArray *sources;
+    /** \brief Sort order of \c index */
+    xsort_t sort;
     /** \brief Number of items stored */
     size_t count;
   } items;
 
+  /** \brief Field selection */
+  struct
+  {
+    /** \brief Field delimiter */
+    char delimiter;
+    /** \brief First field selected for display, matching and output
+     *
+     * Fields are numbered starting at 1. A value of 0 selects the whole item.
+     */
+    unsigned int first[xcmd_field_count];
+    /** \brief Last field selected for display, matching and output
+     *
+     * A value of 0 selects all fields following \c first.
+     */
+    unsigned int last[xcmd_field_count];
+    /** \brief Byte ranges of the selected fields
+     *
+     * For every item there are \c xcmd_field_count ranges into its text,
+     * indexed by the item id. The ranges are computed once by \c
+     * xcmd_finish_items, so fields are never copied. If all selections cover
+     * the whole item, this is \c NULL.
+     */
+    xspan_t *spans;
+    /** \brief Print the id of items instead of their output field */
+    int print_index;
+    /** \brief Print the source of items before their output */
+    int print_source;
+    /** \brief Buffer for \c xcmd_item_output */
+    GString *output;
+  } fields;
+
   /** \brief Container for a subset of items */
   struct
   {
@@ -45,6 +169,19 @@ struct xcmd
      * are written into \c shadow and are finally copied to \c index. This is
      * used to detect changes made by the selection. */
     char **shadow;
+    /** \brief Rank of the items in \c shadow
+     *
+     * This is for internal use only. If the items in \c shadow have different
+     * ranks, they are distributed into \c buckets by rank, keeping their
+     * order within each rank, and both buffers are swapped. */
+    guint8 *ranks;
+    /** \brief Subset of items ordered by rank, for internal use only */
+    char **buckets;
+    /** \brief Positions in \c items.index of the items scanned into \c shadow
+     *
+     * This is for internal use only. Together with \c ranks it is stored in
+     * \c cache, once all items have been scanned. */
+    guint32 *positions;
     /** \brief Number of items stored */
     size_t count;
     /** \brief Currently selectet item in subset */
@@ -53,8 +190,53 @@ struct xcmd
     const char *input;
     /** \brief Auto complete text */
     GString *complete;
+    /** \brief Match-set generation
+     *
+     * This counter is incremented whenever the set of matching items changes,
+     * but not if only the selection changes. Observers may use it as key for
+     * data derived from the match-set, e.g. a cached layout. */
+    size_t generation;
+    /** \brief Number of matches on a page
+     *
+     * If non-zero, matching stops as soon as a page and one page of lookahead
+     * are filled. The remaining items are scanned by \c
+     * xcmd_continue_matching. */
+    size_t page;
+    /** \brief Number of items in \c items.index scanned for matches */
+    size_t scanned;
   } matches;
 
+  /** \brief Cache of match sets
+   *
+   * The matches of recent inputs are stored as compressed bitmaps of their
+   * positions in \c items.index, so an input typed again, e.g. after
+   * backspace, restores \c matches without calling \c match. If \c
+   * match_monotonic is set, only the matches of the longest cached prefix of
+   * an input are scanned. Entries are evicted in least recently used order.
+   */
+  struct
+  {
+    /** \brief Entries by input */
+    GHashTable *entries;
+    /** \brief Most recently used entry */
+    xcentry_t *first;
+    /** \brief Least recently used entry, evicted first */
+    xcentry_t *last;
+    /** \brief Number of bytes used by all entries */
+    size_t size;
+    /** \brief Maximum number of bytes used by all entries
+     *
+     * A value of 0 disables the cache.
+     */
+    size_t capacity;
+    /** \brief Number of inputs found in the cache */
+    size_t hits;
+    /** \brief Number of inputs scanning the matches of a cached prefix */
+    size_t prefix_hits;
+    /** \brief Number of inputs scanning all items */
+    size_t misses;
+  } cache;
+
   /** \brief String comparison function
    *
    * This function pointer controls, how strings are compared. In order to
@@ -78,8 +260,8 @@ struct xcmd
    * pointed to by this variable will be called after completing \c
    * xcmd_update_matching in order to clean-up the state information used by
    * some \c match functions. \c NULL disables this behaviour. In all cases the
-   * variable \c match_data will be set to \c NULL on exit from \c
-   * xcmd_update_matching.
+   * variable \c match_data will be set to \c NULL once all items have been
+   * scanned.
    */
   void(*match_free)(const xcmd_t*,void*);
   /** \brief Match items against input
@@ -88,14 +270,39 @@ struct xcmd
    * inside of \c xcmd_update_matching. This variable is required to point to
    * an appropriate function and must not be \c NULL. For every item in \c
    * all_items the output of the function is checked if it evaluates non-zero
-   * and is inserted into \c matches. The parameters to \c match are as
-   * follows:
+   * and is inserted into \c matches. The value returned is the rank of the
+   * item: items of lower rank are listed first, and items of equal rank keep
+   * their order. The parameters to \c match are as follows:
    * -# \c ptr passed to \c xcmd_update_matching
    * -# \c input passed to \c xcmd_update_matching
-   * -# An item from \c all_items
+   * -# The match field of an item from \c all_items, which is not
+   *    NUL-terminated
+   * -# Length of the match field in bytes
    * -# Value of \c match_data
    */
-  int(*match)(const xcmd_t*,const char*,const char*,const void*);
+  int(*match)(const xcmd_t*,const char*,const char*,size_t,const void*);
+  /** \brief Match a batch of items against input
+   *
+   * The function pointed to by this variable is called with \c n items and
+   * stores the rank of every item, as returned by \c match, in \c ranks. The
+   * input is taken from \c matches.input. The built-in algorithms provide
+   * batch functions generated for every case mode, whose loops call the match
+   * function inline instead of through \c match and \c strncmp. If \c NULL,
+   * e.g. for custom matchers, \c match is called per item.
+   */
+  void(*match_batch)(const xcmd_t*,char*const*,size_t,guint8*);
+  /** \brief Match function returns different ranks
+   *
+   * Ranked matches are only known after scanning all items, so matching
+   * never stops early on a page.
+   */
+  int match_ranked;
+  /** \brief Items matching an input also match all its prefixes
+   *
+   * If set, the matches of a prefix of the input are a superset of its
+   * matches and serve as candidates for \c match.
+   */
+  int match_monotonic;
   void*(*complete_init)(const xcmd_t*);
   void (*complete_free)(const xcmd_t*,void*);
   int(*complete)(const xcmd_t*,char**,size_t*,void*);
@@ -163,6 +370,15 @@ enum xcmd_match
    * non-zero if \c regexec succeeds matching \c item.
    */
   xcmd_match_regex,
+  /** \brief Match items containing all tokens of the input
+   *
+   * The \c input is split into tokens separated by spaces. Items match, if
+   * they contain every token. Items starting with the whole \c input are
+   * ranked first, then items starting with the first token, then all others.
+   * The tokens are compiled into a single Aho-Corasick automaton, so every
+   * item is scanned once for all tokens.
+   */
+  xcmd_match_tokens,
   /** \brief Failure state
    *
    * Invalid matching function. This will result in an error.
@@ -170,6 +386,19 @@ enum xcmd_match
   xcmd_match_none
 };
 
+/** \brief Regular expression engines used by \c xcmd_match_regex */
+enum xcmd_regex
+{
+  /** \brief POSIX extended regular expressions using \c regexec */
+  xcmd_regex_posix,
+  /** \brief Perl compatible regular expressions using \c GRegex
+   *
+   * The \c input is compiled once with \c G_REGEX_OPTIMIZE, which enables JIT
+   * compilation if available.
+   */
+  xcmd_regex_pcre
+};
+
 /** \brief Auto-complete algorithms */
 enum xcmd_complete
 {
@@ -204,6 +433,49 @@ struct xcmd_config
    * installs \c strncmp.
    */
   int         case_insensitive;
+  /** \brief Field delimiter */
+  char        delimiter;
+  /** \brief Field selections
+   *
+   * For display, matching and output a single field \c N, a range of fields
+   * \c N-M or all fields starting at \c N, written as \c N-, can be
+   * selected. Fields are numbered starting at 1. \c NULL selects the whole
+   * item.
+   */
+  char       *fields[xcmd_field_count];
+  /** \brief Print the id of items on selection
+   *
+   * If set non-zero, \c xcmd_item_output returns the zero-based position of
+   * items in input instead of their output field.
+   */
+  int         print_index;
+  /** \brief Print the source of items on selection
+   *
+   * If set non-zero, \c xcmd_item_output prepends the source of items, as
+   * returned by \c xcmd_item_source, followed by the delimiter.
+   */
+  int         print_source;
+  /** \brief Drop duplicate items
+   *
+   * If set non-zero, only the first occurrence of every item is kept. The ids
+   * of items are counted without the duplicates.
+   */
+  int         unique;
+  /** \brief Select sort order */
+  xsort_t     sort;
+  /** \brief Select regular expression engine */
+  xregex_t    regex;
+  /** \brief Number of matches on a page
+   *
+   * If non-zero, \c xcmd_update_matching only scans items, until a page and
+   * one page of lookahead are filled.
+   */
+  size_t      page;
+  /** \brief Maximum number of bytes used for caching match sets
+   *
+   * A value of 0 disables the cache.
+   */
+  size_t      cache;
 };
 
 /** \brief Initialize instance
@@ -223,17 +495,78 @@ void xcmd_destroy(xcmd_t *ptr);
 
 /** \brief Fill list of items
  *
- * The function reads items line by line from stream \c f and stores them in \c
- * all_items of the instance \c ptr. As mltiple calls to \c xcmd_read_items
- * would override previous results, it will result in an error. On success this
- * function returns zero, otherwise a non-zero value is returned.
+ * The function reads items line by line from stream \c f and appends them to
+ * \c items of the instance \c ptr. Lines are read directly into the chunks of
+ * the arena and are indexed as soon as they are complete.
+ *
+ * Streams compressed by gzip, or by zstd if built with \c ZSTD, are detected
+ * by their magic bytes. They are decompressed on a thread of their own, while
+ * the text decompressed so far is split into lines. On success this function
+ * returns zero, otherwise a non-zero value is returned.
  */
 int xcmd_read_items(xcmd_t *ptr, FILE *f);
 
+/** \brief Fill list of items from several streams concurrently
+ *
+ * The function reads every stream of \c streams on a thread of its own into
+ * a separate segment of items, so a slow stream doesn't block the others.
+ * The segments are merged into \c items in order of \c streams without
+ * copying, as soon as all preceding streams are complete. Items are numbered
+ * as if the streams had been concatenated. On success this function returns
+ * zero, otherwise a non-zero value is returned.
+ */
+int xcmd_read_streams(xcmd_t *ptr, FILE **streams, size_t n);
+
+/** \brief Add a single item
+ *
+ * The function appends the first \c n bytes of \c text as new item to \c
+ * all_items of the instance \c ptr. This allows sources other than streams
+ * to fill the list of items before calling \c xcmd_finish_items. On success
+ * this function returns zero, otherwise a non-zero value is returned.
+ */
+int xcmd_add_item(xcmd_t *ptr, const char *text, size_t n);
+
+/** \brief Get the id of an item
+ *
+ * Returns the zero-based position of \c item in input. The item must be taken
+ * from \c items.index or \c matches.index.
+ */
+size_t xcmd_item_id(const char *item);
+
+/** \brief Get the source of an item
+ *
+ * Returns the zero-based index of the stream passed to \c xcmd_read_streams,
+ * that \c item was read from. Items added before or after count as sources
+ * of their own. Without several sources this is always 0.
+ */
+size_t xcmd_item_source(const xcmd_t *ptr, const char *item);
+
+/** \brief Get the length of an item
+ *
+ * Returns the length of \c item in bytes without the trailing NUL-byte. The
+ * item must be taken from \c items.index or \c matches.index.
+ */
+size_t xcmd_item_length(const char *item);
+
+/** \brief Get a field of an item
+ *
+ * Returns the start of the \c field selected for \c item and stores its
+ * length in \c n. The field points into the item and is not NUL-terminated.
+ */
+const char *xcmd_item_field(const xcmd_t *ptr, const char *item, xfield_t field, size_t *n);
+
+/** \brief Get the output of an item
+ *
+ * Returns the text to be printed, when \c item is selected, i.e. its output
+ * field or its id, optionally preceded by its source. The returned string is
+ * valid until the next call to this function.
+ */
+const char *xcmd_item_output(xcmd_t *ptr, const char *item);
+
 /** \brief Complete list of items
  *
- * After complete reading or inserting items, this function will calculate the
- * item \c index of the instance \c ptr. If \c complete_init points to an
+ * After complete reading or inserting items, this function will check the items,
+ * sort their \c index and allocate the \c matches of the instance \c ptr. If \c complete_init points to an
  * appropriate function, it is called to initialize \c complete_data. On
  * success this function returns zero, otherwise a non-zero value is returned.
  */
@@ -267,6 +600,16 @@ int xcmd_update_selected(xcmd_t *ptr, const long offset, const int relative);
  */
 int xcmd_auto_complete(xcmd_t *ptr);
 
+/** \brief Continue scanning for matches
+ *
+ * If \c xcmd_update_matching stopped on a page, the function resumes scanning,
+ * until there are at least \c count matches or \c budget items have been
+ * scanned. Items are matched in batches, so there may be more matches.
+ * Passing \c G_MAXSIZE for both completes the matches. The function returns
+ * non-zero, if items are left to scan.
+ */
+int xcmd_continue_matching(xcmd_t *ptr, size_t count, size_t budget);
+
 /** \brief Notify observer
  *
  * The function itries to notify the observer of \c ptr by calling \c observer.
@@ -279,13 +622,30 @@ int xcmd_auto_complete(xcmd_t *ptr);
 int xcmd_notify_observer(xcmd_t *ptr);
 
 /* Match: Prefix */
-int match_prefix(const xcmd_t *ptr, const char *input, const char *text, const void *data);
-int match_strip_prefix(const xcmd_t *ptr, const char *input, const char *text, const void *data);
+int match_prefix(const xcmd_t *ptr, const char *input, const char *text, size_t n, const void *data);
+int match_strip_prefix(const xcmd_t *ptr, const char *input, const char *text, size_t n, const void *data);
+void match_prefix_batch_case(const xcmd_t *ptr, char *const *items, size_t n, guint8 *ranks);
+void match_prefix_batch_icase(const xcmd_t *ptr, char *const *items, size_t n, guint8 *ranks);
+void match_strip_prefix_batch_case(const xcmd_t *ptr, char *const *items, size_t n, guint8 *ranks);
+void match_strip_prefix_batch_icase(const xcmd_t *ptr, char *const *items, size_t n, guint8 *ranks);
 /* Match: Regex */
-int   match_regex(const xcmd_t *ptr, const char *input, const char *text, const void *data);
+int   match_regex(const xcmd_t *ptr, const char *input, const char *text, size_t n, const void *data);
 void *match_regex_init_case(xcmd_t *ptr, const char *input);
 void *match_regex_init_icase(xcmd_t *ptr, const char *input);
 void  match_regex_free(const xcmd_t *ptr, void *data);
+void  match_regex_batch(const xcmd_t *ptr, char *const *items, size_t n, guint8 *ranks);
+/* Match: GRegex */
+int   match_gregex(const xcmd_t *ptr, const char *input, const char *text, size_t n, const void *data);
+void *match_gregex_init_case(xcmd_t *ptr, const char *input);
+void *match_gregex_init_icase(xcmd_t *ptr, const char *input);
+void  match_gregex_free(const xcmd_t *ptr, void *data);
+void  match_gregex_batch(const xcmd_t *ptr, char *const *items, size_t n, guint8 *ranks);
+/* Match: Tokens */
+int   match_tokens(const xcmd_t *ptr, const char *input, const char *text, size_t n, const void *data);
+void *match_tokens_init_case(xcmd_t *ptr, const char *input);
+void *match_tokens_init_icase(xcmd_t *ptr, const char *input);
+void  match_tokens_free(const xcmd_t *ptr, void *data);
+void  match_tokens_batch(const xcmd_t *ptr, char *const *items, size_t n, guint8 *ranks);
 
 /* Configuration */
 int xcmd_config_load(xcfg_t *ptr, FILE *f);